@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "queue_pmr.hpp"
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ns_per_op(bench_clock::duration d, std::size_t ops)
+{
+	return std::chrono::duration<double, std::nano>(d).count() / static_cast<double>(ops);
+}
+
+// Латентность pop() при разном числе живых блоков в ресурсе
+static void bench_pop_latency(std::size_t max_live)
+{
+	constexpr std::size_t ops = 100000;
+	std::cout << "pop latency (pop + push, " << ops << " ops)\n";
+	for (std::size_t live = 1000; live <= max_live; live *= 10)
+	{
+		DynamicVectorMemoryResource mr;
+		pmr_queue<int> q(&mr);
+		for (std::size_t i = 0; i < live; ++i)
+			q.push(static_cast<int>(i));
+
+		auto start = bench_clock::now();
+		for (std::size_t i = 0; i < ops; ++i)
+		{
+			q.pop();
+			q.push(static_cast<int>(i));
+		}
+		auto elapsed = bench_clock::now() - start;
+		std::cout << "  live=" << live << ": " << ns_per_op(elapsed, ops) << " ns/op\n";
+	}
+}
+
+// pop + push после того, как ресурс повидал много классов размера
+static void bench_size_classes(std::size_t max_classes)
+{
+	constexpr std::size_t ops = 100000;
+	std::cout << "pop latency after touching many size classes (pop + push, " << ops << " ops)\n";
+	for (std::size_t classes = 1; classes <= max_classes; classes *= 10)
+	{
+		DynamicVectorMemoryResource mr;
+		for (std::size_t i = 1; i <= classes; ++i)
+			mr.deallocate(mr.allocate(i * 16, 8), i * 16, 8);
+		pmr_queue<int> q(&mr);
+		for (int i = 0; i < 1000; ++i)
+			q.push(i);
+
+		auto start = bench_clock::now();
+		for (std::size_t i = 0; i < ops; ++i)
+		{
+			q.pop();
+			q.push(static_cast<int>(i));
+		}
+		auto elapsed = bench_clock::now() - start;
+		std::cout << "  classes=" << classes << ": " << ns_per_op(elapsed, ops) << " ns/op\n";
+	}
+}
+
+// push и последовательный обход: отдельные блоки против нарезки из чанков
+static void bench_slab(std::size_t n)
+{
+	std::cout << "push + iterate (" << n << " elements)\n";
+	for (std::size_t chunk_size : {std::size_t{0}, std::size_t{64 * 1024}, std::size_t{2 * 1024 * 1024}})
+	{
+		DynamicVectorMemoryResource mr(DynamicVectorResourceOptions{chunk_size});
+		pmr_queue<int> q(&mr);
+
+		auto start = bench_clock::now();
+		for (std::size_t i = 0; i < n; ++i)
+			q.push(static_cast<int>(i));
+		auto pushed = bench_clock::now();
+		long long sum = 0;
+		for (int v : q)
+			sum += v;
+		auto iterated = bench_clock::now();
+
+		std::cout << "  chunk_size=" << chunk_size << ": push " << ns_per_op(pushed - start, n)
+				  << " ns/op, iterate " << ns_per_op(iterated - pushed, n) << " ns/op (sum " << sum << ")\n";
+	}
+}
+
+// Накладные расходы на учёт блоков: внешняя таблица против заголовков
+template <typename Resource>
+static void bench_tracking_overhead_for(const char *label, std::size_t n, std::size_t chunk_size)
+{
+	Resource mr(DynamicVectorResourceOptions{chunk_size});
+	pmr_queue<int> q(&mr);
+
+	auto start = bench_clock::now();
+	for (std::size_t i = 0; i < n; ++i)
+		q.push(static_cast<int>(i));
+	for (std::size_t i = 0; i < n; ++i)
+	{
+		q.pop();
+		q.push(static_cast<int>(i));
+	}
+	auto elapsed = bench_clock::now() - start;
+
+	std::cout << "  " << label << " chunk_size=" << chunk_size << ": "
+			  << static_cast<double>(mr.metadata_bytes()) / static_cast<double>(n) << " metadata bytes/block, "
+			  << ns_per_op(elapsed, 2 * n) << " ns/op\n";
+}
+
+static void bench_tracking_overhead(std::size_t n)
+{
+	std::cout << "block tracking overhead (" << n << " live queue nodes)\n";
+	for (std::size_t chunk_size : {std::size_t{0}, std::size_t{64 * 1024}})
+	{
+		bench_tracking_overhead_for<DynamicVectorMemoryResource>("side table", n, chunk_size);
+		bench_tracking_overhead_for<IntrusiveDynamicVectorMemoryResource>("headers   ", n, chunk_size);
+	}
+}
+
+// Разрушение очереди целиком: поэлементно против discard() + release()
+static void bench_teardown(std::size_t max_n)
+{
+	std::cout << "queue teardown\n";
+	for (std::size_t n = 1000000; n <= max_n; n *= 10)
+	{
+		DynamicVectorMemoryResource mr(DynamicVectorResourceOptions{2 * 1024 * 1024});
+		{
+			pmr_queue<int> q(&mr);
+			for (std::size_t i = 0; i < n; ++i)
+				q.push(static_cast<int>(i));
+			auto start = bench_clock::now();
+			q.clear();
+			auto elapsed = bench_clock::now() - start;
+			std::cout << "  n=" << n << ": clear " << ns_per_op(elapsed, n) << " ns/node";
+		}
+		{
+			pmr_queue<int> q(&mr);
+			for (std::size_t i = 0; i < n; ++i)
+				q.push(static_cast<int>(i));
+			auto start = bench_clock::now();
+			q.discard();
+			mr.release();
+			auto elapsed = bench_clock::now() - start;
+			std::cout << ", discard + release " << ns_per_op(elapsed, n) << " ns/node\n";
+		}
+	}
+}
+
+// Узловая очередь против сегментированной на одном и том же ресурсе
+template <typename Queue>
+static void bench_queue_layout_for(const char *label, std::size_t n)
+{
+	DynamicVectorMemoryResource mr;
+	Queue q(&mr);
+
+	auto start = bench_clock::now();
+	for (std::size_t i = 0; i < n; ++i)
+		q.push(static_cast<int>(i));
+	auto pushed = bench_clock::now();
+	long long sum = 0;
+	for (int v : q)
+		sum += v;
+	auto iterated = bench_clock::now();
+	while (!q.empty())
+		q.pop();
+	auto popped = bench_clock::now();
+
+	std::cout << "  " << label << ": push " << ns_per_op(pushed - start, n) << " ns/op, iterate "
+			  << ns_per_op(iterated - pushed, n) << " ns/op, pop " << ns_per_op(popped - iterated, n)
+			  << " ns/op (sum " << sum << ")\n";
+}
+
+static void bench_queue_layout(std::size_t n)
+{
+	std::cout << "queue layout (" << n << " ints)\n";
+	bench_queue_layout_for<pmr_queue<int>>("pmr_queue          ", n);
+	bench_queue_layout_for<pmr_segmented_queue<int>>("pmr_segmented_queue", n);
+	bench_queue_layout_for<pmr_ring_queue<int>>("pmr_ring_queue     ", n);
+}
+
+// Один производитель и один потребитель: SPSC-очередь против pmr_queue под мьютексом
+static void bench_spsc(std::size_t n)
+{
+	std::cout << "two-thread hand-off (" << n << " items)\n";
+	{
+		DynamicVectorMemoryResource mr;
+		pmr_spsc_queue<std::size_t> q(1024, &mr);
+		auto start = bench_clock::now();
+		std::thread producer([&q, n]
+							 {
+			for (std::size_t i = 0; i < n; ++i)
+				while (!q.try_push(i))
+					std::this_thread::yield(); });
+		std::size_t value = 0;
+		std::size_t sum = 0;
+		for (std::size_t received = 0; received < n;)
+		{
+			if (q.try_pop(value))
+			{
+				sum += value;
+				++received;
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+		producer.join();
+		auto elapsed = bench_clock::now() - start;
+		std::cout << "  pmr_spsc_queue:          " << ns_per_op(elapsed, n) << " ns/item (sum " << sum << ")\n";
+	}
+	{
+		DynamicVectorMemoryResource mr;
+		pmr_queue<std::size_t> q(&mr);
+		std::mutex m;
+		auto start = bench_clock::now();
+		std::thread producer([&q, &m, n]
+							 {
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				std::lock_guard<std::mutex> lock(m);
+				q.push(i);
+			} });
+		std::size_t value = 0;
+		std::size_t sum = 0;
+		for (std::size_t received = 0; received < n;)
+		{
+			bool popped = false;
+			{
+				std::lock_guard<std::mutex> lock(m);
+				popped = q.try_pop(value);
+			}
+			if (popped)
+			{
+				sum += value;
+				++received;
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+		producer.join();
+		auto elapsed = bench_clock::now() - start;
+		std::cout << "  pmr_queue + std::mutex:  " << ns_per_op(elapsed, n) << " ns/item (sum " << sum << ")\n";
+	}
+}
+
+// P производителей и P потребителей: lock-free MPMC-очереди против pmr_queue под мьютексом
+template <typename Push, typename TryPop>
+static double run_mpmc(std::size_t threads, std::size_t n, Push push, TryPop try_pop)
+{
+	const std::size_t per_thread = n / threads;
+	std::vector<std::thread> workers;
+	auto start = bench_clock::now();
+	for (std::size_t t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&push, per_thread]
+							 {
+			for (std::size_t i = 0; i < per_thread; ++i)
+				push(i); });
+		workers.emplace_back([&try_pop, per_thread]
+							 {
+			std::size_t value = 0;
+			for (std::size_t received = 0; received < per_thread;)
+			{
+				if (try_pop(value))
+					++received;
+				else
+					std::this_thread::yield();
+			} });
+	}
+	for (auto &worker : workers)
+		worker.join();
+	return ns_per_op(bench_clock::now() - start, per_thread * threads);
+}
+
+static void bench_mpmc(std::size_t n)
+{
+	const std::size_t max_threads = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+	std::cout << "MPMC scaling (" << n << " items, P producers + P consumers)\n";
+	for (std::size_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		double lock_free = 0;
+		{
+			std::pmr::synchronized_pool_resource mr;
+			pmr_mpmc_queue<std::size_t> q(&mr);
+			lock_free = run_mpmc(threads, n, [&q](std::size_t v)
+								 { q.push(v); },
+								 [&q](std::size_t &v)
+								 { return q.try_pop(v); });
+		}
+		double bounded = 0;
+		{
+			DynamicVectorMemoryResource mr;
+			pmr_bounded_mpmc_queue<std::size_t> q(1024, &mr);
+			bounded = run_mpmc(threads, n, [&q](std::size_t v)
+							   {
+				while (!q.try_push(v))
+					std::this_thread::yield(); },
+							   [&q](std::size_t &v)
+							   { return q.try_pop(v); });
+		}
+		double locked = 0;
+		{
+			std::pmr::synchronized_pool_resource mr;
+			pmr_queue<std::size_t> q(&mr);
+			std::mutex m;
+			locked = run_mpmc(threads, n, [&](std::size_t v)
+							  { std::lock_guard<std::mutex> lock(m); q.push(v); },
+							  [&](std::size_t &v)
+							  { std::lock_guard<std::mutex> lock(m); return q.try_pop(v); });
+		}
+		std::cout << "  P=" << threads << ": pmr_mpmc_queue " << lock_free << " ns/item, pmr_bounded_mpmc_queue "
+				  << bounded << " ns/item, pmr_queue + std::mutex " << locked << " ns/item\n";
+	}
+}
+
+// Блокирующая очередь: пробуждение на каждый элемент против пакетного
+static void bench_blocking(std::size_t n)
+{
+	std::cout << "blocking hand-off (" << n << " items)\n";
+	for (std::size_t threshold : {std::size_t{1}, std::size_t{64}})
+	{
+		DynamicVectorMemoryResource mr;
+		pmr_blocking_queue<std::size_t> q(threshold, std::chrono::microseconds(200), &mr);
+		std::vector<std::size_t> batch;
+		std::size_t wakeups = 0;
+		std::size_t sum = 0;
+		auto start = bench_clock::now();
+		std::thread producer([&q, n]
+							 {
+			for (std::size_t i = 0; i < n; ++i)
+				q.push(i); });
+		for (std::size_t received = 0; received < n;)
+		{
+			batch.clear();
+			q.pop_batch_wait(std::back_inserter(batch), 1024);
+			++wakeups;
+			received += batch.size();
+			for (std::size_t v : batch)
+				sum += v;
+		}
+		producer.join();
+		auto elapsed = bench_clock::now() - start;
+		std::cout << "  wake_threshold=" << threshold << ": " << ns_per_op(elapsed, n) << " ns/item, " << wakeups
+				  << " wake-ups (sum " << sum << ")\n";
+	}
+}
+
+// Многопоточные выделения с освобождением в чужих потоках: каждый поток заполняет
+// пакет блоков и обменивается им с другими через общий слот
+template <typename Resource>
+static double run_resource_stress(Resource &mr, std::size_t threads, std::size_t n)
+{
+	constexpr std::size_t batch_size = 64;
+	struct Batch
+	{
+		std::array<void *, batch_size> ptrs{};
+		std::array<std::size_t, batch_size> sizes{};
+		std::size_t count = 0;
+	};
+
+	std::vector<Batch> batches(threads + 1);
+	std::atomic<Batch *> exchange{&batches[threads]};
+	const std::size_t rounds = std::max<std::size_t>(1, n / threads / batch_size);
+	std::vector<std::thread> workers;
+	auto start = bench_clock::now();
+	for (std::size_t t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&mr, &exchange, batch = &batches[t], rounds, t]() mutable
+							 {
+			std::size_t seed = t * 7919 + 1;
+			for (std::size_t r = 0; r < rounds; ++r)
+			{
+				for (std::size_t i = 0; i < batch_size; ++i)
+				{
+					seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+					batch->sizes[i] = 16 + (seed >> 58) * 16;
+					batch->ptrs[i] = mr.allocate(batch->sizes[i]);
+				}
+				batch->count = batch_size;
+				batch = exchange.exchange(batch, std::memory_order_acq_rel);
+				for (std::size_t i = 0; i < batch->count; ++i)
+					mr.deallocate(batch->ptrs[i], batch->sizes[i]);
+				batch->count = 0;
+			} });
+	}
+	for (auto &worker : workers)
+		worker.join();
+	Batch *last = exchange.load();
+	for (std::size_t i = 0; i < last->count; ++i)
+		mr.deallocate(last->ptrs[i], last->sizes[i]);
+	return ns_per_op(bench_clock::now() - start, rounds * threads * batch_size);
+}
+
+static void bench_resource_stress(std::size_t n)
+{
+	const std::size_t max_threads = std::max<std::size_t>(32, std::thread::hardware_concurrency());
+	std::cout << "thread-safe resources (" << n << " allocate + deallocate pairs, cross-thread frees)\n";
+	for (std::size_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		double sharded = 0;
+		{
+			ShardedDynamicVectorMemoryResource mr(0, DynamicVectorResourceOptions{64 * 1024});
+			sharded = run_resource_stress(mr, threads, n);
+		}
+		double cached = 0;
+		{
+			DynamicVectorMemoryResource backend(DynamicVectorResourceOptions{64 * 1024});
+			ThreadCachingMemoryResource mr(&backend);
+			cached = run_resource_stress(mr, threads, n);
+		}
+		double pool = 0;
+		{
+			std::pmr::synchronized_pool_resource mr;
+			pool = run_resource_stress(mr, threads, n);
+		}
+		std::cout << "  threads=" << threads << ": sharded " << sharded << " ns/pair, thread caching "
+				  << cached << " ns/pair, synchronized_pool_resource " << pool << " ns/pair\n";
+	}
+}
+
+int main(int argc, char **argv)
+{
+	const std::string name = argc > 1 ? argv[1] : "all";
+	const std::size_t max_n = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000000;
+
+	if (name == "all" || name == "pop_latency")
+		bench_pop_latency(max_n);
+	if (name == "all" || name == "size_classes")
+		bench_size_classes(std::min<std::size_t>(max_n, 10000));
+	if (name == "all" || name == "slab")
+		bench_slab(max_n);
+	if (name == "all" || name == "tracking")
+		bench_tracking_overhead(max_n);
+	if (name == "all" || name == "teardown")
+		bench_teardown(max_n);
+	if (name == "all" || name == "layout")
+		bench_queue_layout(max_n);
+	if (name == "all" || name == "spsc")
+		bench_spsc(max_n);
+	if (name == "all" || name == "mpmc")
+		bench_mpmc(max_n);
+	if (name == "all" || name == "blocking")
+		bench_blocking(max_n);
+	if (name == "all" || name == "resource_stress")
+		bench_resource_stress(max_n);
+
+	return 0;
+}
@@ -4,235 +4,3124 @@
 #include <memory_resource>
 #include <vector>
 #include <cstddef>
+#include <functional>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
 #include <forward_list>
 #include <iterator>
 #include <type_traits>
 #include <algorithm>
+#include <atomic>
+#include <optional>
+#include <ranges>
+#include <utility>
+#include <array>
+#include <bit>
+#include <new>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <stop_token>
 
-class DynamicVectorMemoryResource : public std::pmr::memory_resource
+struct DynamicVectorResourceOptions
+{
+	// Размер чанка в байтах; 0 — каждый блок запрашивается в куче отдельно.
+	std::size_t chunk_size = 0;
+};
+
+// Политики учёта блоков: внешняя таблица с хеш-индексом либо заголовок перед каждым блоком.
+struct SideTableTracking
+{
+};
+
+struct IntrusiveHeaderTracking
+{
+};
+
+// Политики сбора статистики: без счётчиков (по умолчанию) либо с ними.
+struct NoAllocationStats
+{
+	static constexpr bool enabled = false;
+};
+
+struct CollectAllocationStats
+{
+	static constexpr bool enabled = true;
+};
+
+struct AllocationStats
+{
+	std::size_t live_bytes = 0;
+	std::size_t peak_bytes = 0;
+	std::size_t allocations = 0;
+	std::size_t deallocations = 0;
+	// Освобождения чужих указателей и повторные освобождения; они игнорируются.
+	std::size_t unknown_deallocations = 0;
+	std::size_t lookups = 0;
+	std::size_t lookup_probes = 0;
+	// Элемент i — число выделений с классом размера в (16 * 2^(i-1), 16 * 2^i] байт.
+	std::array<std::size_t, 64> size_class_histogram{};
+
+	double average_probe_length() const noexcept
+	{
+		return lookups == 0 ? 0.0 : static_cast<double>(lookup_probes) / static_cast<double>(lookups);
+	}
+};
+
+template <typename Tracking = SideTableTracking, typename Stats = NoAllocationStats>
+class BasicDynamicVectorMemoryResource : public std::pmr::memory_resource
 {
 private:
+	static constexpr bool intrusive = std::is_same_v<Tracking, IntrusiveHeaderTracking>;
+
+	// Заголовок блока в режиме IntrusiveHeaderTracking; лежит сразу перед возвращаемым указателем.
+	struct BlockHeader
+	{
+		const void *owner;
+		std::uint32_t size_units;
+		std::uint8_t align_log2;
+		std::uint8_t slab;
+		std::uint8_t allocated;
+	};
+
+	// Связи отдельно выделенных блоков в режиме заголовков: лежат перед заголовком,
+	// по ним деструктор находит всю память.
+	struct DirectLinks
+	{
+		DirectLinks *prev;
+		DirectLinks *next;
+	};
+
 	struct BlockInfo
 	{
-		void *ptr;
-		std::size_t size;
-		std::size_t alignment;
-		bool allocated;
+		void *ptr;
+		std::size_t size;
+		std::size_t alignment;
+		bool allocated;
+	};
+
+	// Список свободных блоков одного класса размера и выравнивания;
+	// ссылка на следующий блок хранится в памяти самого свободного блока.
+	struct FreeList
+	{
+		std::size_t size;
+		std::size_t alignment;
+		void *head;
+		bool slab;
+	};
+
+	// В режиме внешней таблицы у чанка есть битовая карта занятости: бит на каждые
+	// size_granularity байт, взведён у начала выданного блока. По ней отбрасываются
+	// повторные освобождения блоков из чанков.
+	struct ChunkInfo
+	{
+		void *ptr;
+		std::size_t size;
+		std::uint64_t *live_bits;
+	};
+
+	static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+	static constexpr std::size_t size_granularity = alignof(std::max_align_t);
+	static constexpr std::size_t min_cached_blocks = 64;
+	// Классы до direct_classes * size_granularity байт с обычным выравниванием
+	// адресуются прямо по size / size_granularity, остальные ищутся в хеш-таблице.
+	static constexpr std::size_t direct_classes = 64;
+
+	DynamicVectorResourceOptions options_;
+	std::pmr::memory_resource *upstream_;
+	std::pmr::vector<BlockInfo> blocks_;
+	std::pmr::vector<FreeList> small_lists_;
+	// Открытая адресация с линейным пробированием; слот с size == 0 пуст.
+	std::pmr::vector<FreeList> large_lists_;
+	std::size_t large_count_ = 0;
+	// Чанки отсортированы по адресу; блоки нарезаются из последнего выделенного.
+	std::pmr::vector<ChunkInfo> chunks_;
+	std::byte *chunk_cursor_ = nullptr;
+	std::byte *chunk_end_ = nullptr;
+	// Начало и битовая карта чанка, из которого сейчас нарезаются блоки.
+	std::byte *chunk_base_ = nullptr;
+	std::uint64_t *chunk_bits_ = nullptr;
+	// Индекс следующего сохранённого после reset() чанка, который ещё не нарезался.
+	std::size_t next_chunk_ = 0;
+	std::size_t live_blocks_ = 0;
+	std::size_t cached_blocks_ = 0;
+	// Открытая адресация с линейным пробированием: слот хранит индекс в blocks_ или npos.
+	std::pmr::vector<std::size_t> index_;
+	DirectLinks *direct_head_ = nullptr;
+	std::size_t header_bytes_ = 0;
+	[[no_unique_address]] std::conditional_t<Stats::enabled, AllocationStats, NoAllocationStats> stats_;
+
+	static std::size_t mix_bits(std::uint64_t h) noexcept
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return static_cast<std::size_t>(h);
+	}
+
+	static std::size_t hash_pointer(const void *p) noexcept
+	{
+		return mix_bits(static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p)));
+	}
+
+	static std::size_t hash_class(std::size_t size, std::size_t alignment) noexcept
+	{
+		return mix_bits(static_cast<std::uint64_t>(size) ^
+						(static_cast<std::uint64_t>(std::countr_zero(alignment)) << 58));
+	}
+
+	std::size_t find_slot(const void *p) const noexcept
+	{
+		const std::size_t mask = index_.size() - 1;
+		std::size_t slot = hash_pointer(p) & mask;
+		while (index_[slot] != npos && blocks_[index_[slot]].ptr != p)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	void rebuild_index(std::size_t capacity)
+	{
+		rebuild_index(std::pmr::vector<std::size_t>(capacity, npos, upstream_));
+	}
+
+	void rebuild_index(std::pmr::vector<std::size_t> &&slots) noexcept
+	{
+		index_ = std::move(slots);
+		for (std::size_t i = 0; i < blocks_.size(); ++i)
+			index_[find_slot(blocks_[i].ptr)] = i;
+	}
+
+	void reserve_index_for_insert()
+	{
+		if ((blocks_.size() + 1) * 2 > index_.size())
+			rebuild_index(std::max<std::size_t>(16, index_.size() * 2));
+		if (blocks_.size() == blocks_.capacity())
+			blocks_.reserve(std::max<std::size_t>(16, blocks_.capacity() * 2));
+	}
+
+	static std::size_t size_class(std::size_t bytes) noexcept
+	{
+		if (bytes == 0)
+			return size_granularity;
+		return (bytes + size_granularity - 1) / size_granularity * size_granularity;
+	}
+
+	static std::size_t alignment_class(std::size_t alignment) noexcept
+	{
+		return std::max(alignment, alignof(std::max_align_t));
+	}
+
+	std::size_t find_large_slot(std::size_t size, std::size_t alignment) const noexcept
+	{
+		const std::size_t mask = large_lists_.size() - 1;
+		std::size_t slot = hash_class(size, alignment) & mask;
+		while (large_lists_[slot].size != 0 &&
+			   (large_lists_[slot].size != size || large_lists_[slot].alignment != alignment))
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	void rehash_large_lists(std::pmr::vector<FreeList> &&table) noexcept
+	{
+		std::swap(large_lists_, table);
+		for (const auto &list : table)
+		{
+			if (list.size != 0)
+				large_lists_[find_large_slot(list.size, list.alignment)] = list;
+		}
+	}
+
+	static bool is_direct_class(std::size_t size, std::size_t alignment) noexcept
+	{
+		return alignment == size_granularity && size <= direct_classes * size_granularity;
+	}
+
+	// Заводит крупный класс в таблице, не расширяя её; место должно быть.
+	FreeList &place_large_list(std::size_t size, std::size_t alignment) noexcept
+	{
+		FreeList &list = large_lists_[find_large_slot(size, alignment)];
+		if (list.size == 0)
+		{
+			list = {size, alignment, nullptr, is_slab_class(size, alignment)};
+			++large_count_;
+		}
+		return list;
+	}
+
+	// Список уже заведённого класса либо nullptr; память не выделяет, поэтому
+	// годится для освобождения: класс выданного блока всегда заведён.
+	FreeList *find_free_list(std::size_t size, std::size_t alignment) noexcept
+	{
+		if (is_direct_class(size, alignment))
+		{
+			const std::size_t i = size / size_granularity - 1;
+			return i < small_lists_.size() ? &small_lists_[i] : nullptr;
+		}
+		if (large_lists_.empty())
+			return nullptr;
+		FreeList &list = large_lists_[find_large_slot(size, alignment)];
+		return list.size == 0 ? nullptr : &list;
+	}
+
+	// Список класса, заводя его при первом выделении; может расширить таблицу.
+	FreeList &free_list_for(std::size_t size, std::size_t alignment)
+	{
+		if (FreeList *list = find_free_list(size, alignment))
+			return *list;
+
+		if (is_direct_class(size, alignment))
+		{
+			const std::size_t i = size / size_granularity - 1;
+			const std::size_t old_size = small_lists_.size();
+			small_lists_.resize(std::min(direct_classes, std::bit_ceil(i + 1)));
+			for (std::size_t j = old_size; j < small_lists_.size(); ++j)
+			{
+				const std::size_t class_size = (j + 1) * size_granularity;
+				small_lists_[j] = {class_size, size_granularity, nullptr, is_slab_class(class_size, size_granularity)};
+			}
+			return small_lists_[i];
+		}
+
+		if ((large_count_ + 1) * 2 > large_lists_.size())
+			rehash_large_lists(std::pmr::vector<FreeList>(std::max<std::size_t>(16, large_lists_.size() * 2),
+														  FreeList{}, upstream_));
+		return place_large_list(size, alignment);
+	}
+
+	template <typename Function>
+	void for_each_free_list(Function function) noexcept
+	{
+		for (auto &list : small_lists_)
+			function(list);
+		for (auto &list : large_lists_)
+		{
+			if (list.size != 0)
+				function(list);
+		}
+	}
+
+	bool is_slab_class(std::size_t size, std::size_t alignment) const noexcept
+	{
+		return size <= options_.chunk_size / 8 && alignment <= options_.chunk_size / 8;
+	}
+
+	// Чанк, которому принадлежит адрес p, либо nullptr.
+	const ChunkInfo *find_chunk(const void *p) const noexcept
+	{
+		auto it = std::upper_bound(chunks_.begin(), chunks_.end(), p,
+								   [](const void *q, const ChunkInfo &c)
+								   { return std::less<const void *>()(q, c.ptr); });
+		if (it == chunks_.begin())
+			return nullptr;
+		--it;
+		return std::less<const void *>()(p, static_cast<std::byte *>(it->ptr) + it->size) ? &*it : nullptr;
+	}
+
+	std::size_t chunk_bitmap_words() const noexcept
+	{
+		return (options_.chunk_size / size_granularity + 63) / 64;
+	}
+
+	// Переключает бит занятости блока p в чанке с началом base; false — бит уже был в нужном состоянии.
+	static bool set_live_bit(std::uint64_t *bits, const std::byte *base, const void *p, bool live) noexcept
+	{
+		const std::size_t unit = static_cast<std::size_t>(static_cast<const std::byte *>(p) - base) / size_granularity;
+		const std::uint64_t mask = std::uint64_t{1} << (unit % 64);
+		std::uint64_t &word = bits[unit / 64];
+		if (((word & mask) != 0) == live)
+			return false;
+		word ^= mask;
+		return true;
+	}
+
+	void *carve_from_chunk(std::size_t size, std::size_t alignment)
+	{
+		auto aligned = [alignment](std::byte *p)
+		{
+			const auto addr = reinterpret_cast<std::uintptr_t>(p);
+			return p + ((alignment - addr % alignment) % alignment);
+		};
+		std::byte *ptr = chunk_cursor_ == nullptr ? nullptr : aligned(chunk_cursor_);
+		if ((ptr == nullptr || static_cast<std::size_t>(chunk_end_ - ptr) < size) && next_chunk_ < chunks_.size())
+		{
+			chunk_base_ = chunk_cursor_ = static_cast<std::byte *>(chunks_[next_chunk_].ptr);
+			chunk_end_ = chunk_cursor_ + chunks_[next_chunk_].size;
+			chunk_bits_ = chunks_[next_chunk_].live_bits;
+			++next_chunk_;
+			ptr = aligned(chunk_cursor_);
+		}
+		if (ptr == nullptr || static_cast<std::size_t>(chunk_end_ - ptr) < size)
+		{
+			chunks_.reserve(chunks_.size() + 1);
+			void *chunk = upstream_->allocate(options_.chunk_size, alignof(std::max_align_t));
+			std::uint64_t *bits = nullptr;
+			if constexpr (!intrusive)
+			{
+				try
+				{
+					bits = static_cast<std::uint64_t *>(
+						upstream_->allocate(chunk_bitmap_words() * sizeof(std::uint64_t), alignof(std::uint64_t)));
+				}
+				catch (...)
+				{
+					upstream_->deallocate(chunk, options_.chunk_size, alignof(std::max_align_t));
+					throw;
+				}
+				std::fill_n(bits, chunk_bitmap_words(), std::uint64_t{0});
+			}
+			auto pos = std::upper_bound(chunks_.begin(), chunks_.end(), chunk,
+										[](const void *q, const ChunkInfo &c)
+										{ return std::less<const void *>()(q, c.ptr); });
+			chunks_.insert(pos, {chunk, options_.chunk_size, bits});
+			next_chunk_ = chunks_.size();
+			chunk_base_ = chunk_cursor_ = static_cast<std::byte *>(chunk);
+			chunk_end_ = chunk_cursor_ + options_.chunk_size;
+			chunk_bits_ = bits;
+			ptr = aligned(chunk_cursor_);
+		}
+		chunk_cursor_ = ptr + size;
+		return ptr;
+	}
+
+	static void *pop_free(FreeList &list) noexcept
+	{
+		void *ptr = list.head;
+		if (ptr != nullptr)
+			std::memcpy(&list.head, ptr, sizeof(void *));
+		return ptr;
+	}
+
+	static void push_free(FreeList &list, void *ptr) noexcept
+	{
+		std::memcpy(ptr, &list.head, sizeof(void *));
+		list.head = ptr;
+	}
+
+	static std::size_t index_capacity_for(std::size_t count) noexcept
+	{
+		std::size_t capacity = 16;
+		while (capacity < count * 2)
+			capacity *= 2;
+		return capacity;
+	}
+
+	// Возвращает лишние закэшированные блоки в кучу и ужимает метаданные,
+	// чтобы их объём оставался пропорционален числу живых блоков: в хеш-таблице
+	// классов остаются только классы чанков и классы блоков из blocks_.
+	void compact() noexcept
+	{
+		std::size_t keep = std::max(live_blocks_, min_cached_blocks);
+		const std::size_t kept_blocks = live_blocks_ + std::min(keep, cached_blocks_);
+		std::size_t slab_classes = 0;
+		for (const auto &list : large_lists_)
+			slab_classes += list.size != 0 && list.slab;
+		std::pmr::vector<std::size_t> slots(upstream_);
+		std::pmr::vector<FreeList> lists(upstream_);
+		try
+		{
+			slots.assign(index_capacity_for(kept_blocks), npos);
+			if (!large_lists_.empty())
+				lists.assign(std::min(large_lists_.size(), index_capacity_for(slab_classes + kept_blocks)), FreeList{});
+		}
+		catch (const std::bad_alloc &)
+		{
+			return;
+		}
+
+		for (std::size_t i = 0; i < blocks_.size();)
+		{
+			if (!blocks_[i].allocated && keep == 0)
+			{
+				upstream_->deallocate(blocks_[i].ptr, blocks_[i].size, blocks_[i].alignment);
+				blocks_[i] = blocks_.back();
+				blocks_.pop_back();
+				--cached_blocks_;
+				continue;
+			}
+			if (!blocks_[i].allocated)
+				--keep;
+			++i;
+		}
+
+		for_each_free_list([](FreeList &list)
+						   { list.head = list.slab ? list.head : nullptr; });
+		// Новая таблица вмещает все оставшиеся классы с загрузкой не выше 1/2,
+		// поэтому крупные классы заводятся в ней без расширения; малые классы
+		// блоков заведены ещё при их выделении.
+		std::swap(large_lists_, lists);
+		large_count_ = 0;
+		for (const auto &list : lists)
+		{
+			if (list.size != 0 && list.slab)
+			{
+				large_lists_[find_large_slot(list.size, list.alignment)] = list;
+				++large_count_;
+			}
+		}
+		for (auto &block : blocks_)
+		{
+			FreeList *list = find_free_list(block.size, block.alignment);
+			if (list == nullptr)
+				list = &place_large_list(block.size, block.alignment);
+			if (!block.allocated)
+				push_free(*list, block.ptr);
+		}
+
+		if (blocks_.capacity() > 4 * std::max<std::size_t>(16, blocks_.size()))
+		{
+			try
+			{
+				blocks_.shrink_to_fit();
+			}
+			catch (const std::bad_alloc &)
+			{
+			}
+		}
+		rebuild_index(std::move(slots));
+	}
+
+	static std::size_t round_up(std::size_t n, std::size_t alignment) noexcept
+	{
+		return (n + alignment - 1) / alignment * alignment;
+	}
+
+	static std::size_t slab_header_offset(std::size_t alignment) noexcept
+	{
+		return round_up(sizeof(BlockHeader), alignment);
+	}
+
+	static std::size_t direct_header_offset(std::size_t alignment) noexcept
+	{
+		return round_up(sizeof(DirectLinks) + sizeof(BlockHeader), alignment);
+	}
+
+	static BlockHeader *header_of(void *p) noexcept
+	{
+		return reinterpret_cast<BlockHeader *>(static_cast<std::byte *>(p) - sizeof(BlockHeader));
+	}
+
+	void *place_header(std::byte *payload, std::size_t size, std::size_t alignment, bool slab) noexcept
+	{
+		auto *header = header_of(payload);
+		header->owner = this;
+		header->size_units = static_cast<std::uint32_t>(size / size_granularity);
+		header->align_log2 = static_cast<std::uint8_t>(std::countr_zero(alignment));
+		header->slab = slab;
+		header->allocated = true;
+		return payload;
+	}
+
+	static DirectLinks *links_of(void *p) noexcept
+	{
+		return reinterpret_cast<DirectLinks *>(header_of(p)) - 1;
+	}
+
+	static void *payload_of(DirectLinks *links) noexcept
+	{
+		return reinterpret_cast<std::byte *>(links + 1) + sizeof(BlockHeader);
+	}
+
+	void release_direct(void *p) noexcept
+	{
+		const BlockHeader *header = header_of(p);
+		const std::size_t size = header->size_units * size_granularity;
+		const std::size_t alignment = std::size_t{1} << header->align_log2;
+		const std::size_t offset = direct_header_offset(alignment);
+		DirectLinks *links = links_of(p);
+		if (links->prev != nullptr)
+			links->prev->next = links->next;
+		else
+			direct_head_ = links->next;
+		if (links->next != nullptr)
+			links->next->prev = links->prev;
+		header_bytes_ -= offset;
+		upstream_->deallocate(static_cast<std::byte *>(p) - offset, offset + size, alignment);
+	}
+
+	void *allocate_with_header(std::size_t size, std::size_t alignment)
+	{
+		if (size / size_granularity > UINT32_MAX)
+			throw std::bad_alloc();
+		FreeList &list = free_list_for(size, alignment);
+		if (void *ptr = pop_free(list))
+		{
+			header_of(ptr)->allocated = true;
+			if (!list.slab)
+			{
+				--cached_blocks_;
+				++live_blocks_;
+			}
+			return ptr;
+		}
+		if (list.slab)
+		{
+			const std::size_t offset = slab_header_offset(alignment);
+			auto *base = static_cast<std::byte *>(carve_from_chunk(offset + size, alignment));
+			header_bytes_ += offset;
+			return place_header(base + offset, size, alignment, true);
+		}
+
+		const std::size_t offset = direct_header_offset(alignment);
+		auto *payload = static_cast<std::byte *>(upstream_->allocate(offset + size, alignment)) + offset;
+		DirectLinks *links = links_of(payload);
+		links->prev = nullptr;
+		links->next = direct_head_;
+		if (direct_head_ != nullptr)
+			direct_head_->prev = links;
+		direct_head_ = links;
+		header_bytes_ += offset;
+		++live_blocks_;
+		return place_header(payload, size, alignment, false);
+	}
+
+	bool deallocate_with_header(void *p) noexcept
+	{
+		if constexpr (Stats::enabled)
+		{
+			++stats_.lookups;
+			++stats_.lookup_probes;
+		}
+		BlockHeader *header = header_of(p);
+		if (header->owner != this || !header->allocated)
+			return false;
+		FreeList *list = find_free_list(header->size_units * size_granularity, std::size_t{1} << header->align_log2);
+		if (list == nullptr)
+			return false;
+		header->allocated = false;
+		if (header->slab)
+		{
+			push_free(*list, p);
+			return true;
+		}
+		--live_blocks_;
+		if (cached_blocks_ >= 2 * std::max(live_blocks_, min_cached_blocks))
+		{
+			release_direct(p);
+			return true;
+		}
+		push_free(*list, p);
+		++cached_blocks_;
+		return true;
+	}
+
+	auto find_block(void *p, std::size_t *probes = nullptr)
+	{
+		if (index_.empty())
+			return blocks_.end();
+		const std::size_t slot = find_slot(p);
+		if (probes != nullptr)
+			*probes = ((slot - hash_pointer(p)) & (index_.size() - 1)) + 1;
+		if (index_[slot] == npos)
+			return blocks_.end();
+		return blocks_.begin() + static_cast<std::ptrdiff_t>(index_[slot]);
+	}
+
+	void *allocate_with_side_table(std::size_t size, std::size_t align)
+	{
+		FreeList &list = free_list_for(size, align);
+		if (list.slab)
+		{
+			if (void *ptr = pop_free(list))
+			{
+				const ChunkInfo *chunk = find_chunk(ptr);
+				set_live_bit(chunk->live_bits, static_cast<std::byte *>(chunk->ptr), ptr, true);
+				return ptr;
+			}
+			void *ptr = carve_from_chunk(size, align);
+			set_live_bit(chunk_bits_, chunk_base_, ptr, true);
+			return ptr;
+		}
+		if (void *ptr = pop_free(list))
+		{
+			find_block(ptr)->allocated = true;
+			--cached_blocks_;
+			++live_blocks_;
+			return ptr;
+		}
+
+		reserve_index_for_insert();
+		void *ptr = upstream_->allocate(size, align);
+		index_[find_slot(ptr)] = blocks_.size();
+		blocks_.push_back({ptr, size, align, true});
+		++live_blocks_;
+		return ptr;
+	}
+
+	bool deallocate_with_side_table(void *p, std::size_t size, std::size_t align) noexcept
+	{
+		std::size_t probes = 0;
+		auto it = find_block(p, Stats::enabled ? &probes : nullptr);
+		if constexpr (Stats::enabled)
+		{
+			++stats_.lookups;
+			stats_.lookup_probes += probes;
+		}
+		if (it != blocks_.end())
+		{
+			FreeList *list = find_free_list(it->size, it->alignment);
+			if (!it->allocated || list == nullptr)
+				return false;
+			push_free(*list, p);
+			it->allocated = false;
+			--live_blocks_;
+			++cached_blocks_;
+			if (cached_blocks_ > 2 * std::max(live_blocks_, min_cached_blocks))
+				compact();
+			return true;
+		}
+
+		FreeList *list = find_free_list(size, align);
+		if (list == nullptr || !list->slab)
+			return false;
+		const ChunkInfo *chunk = find_chunk(p);
+		if (chunk == nullptr ||
+			static_cast<std::size_t>(static_cast<std::byte *>(p) - static_cast<std::byte *>(chunk->ptr)) % size_granularity != 0 ||
+			!set_live_bit(chunk->live_bits, static_cast<std::byte *>(chunk->ptr), p, false))
+			return false;
+		push_free(*list, p);
+		return true;
+	}
+
+protected:
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		const std::size_t size = size_class(bytes);
+		const std::size_t align = alignment_class(alignment);
+		void *ptr = intrusive ? allocate_with_header(size, align) : allocate_with_side_table(size, align);
+		if constexpr (Stats::enabled)
+		{
+			++stats_.allocations;
+			stats_.live_bytes += bytes;
+			stats_.peak_bytes = std::max(stats_.peak_bytes, stats_.live_bytes);
+			++stats_.size_class_histogram[std::bit_width(size / size_granularity - 1)];
+		}
+		return ptr;
+	}
+
+	void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+	{
+		const bool known = intrusive ? deallocate_with_header(p)
+									 : deallocate_with_side_table(p, size_class(bytes), alignment_class(alignment));
+		if constexpr (Stats::enabled)
+		{
+			if (known)
+			{
+				++stats_.deallocations;
+				stats_.live_bytes -= bytes;
+			}
+			else
+			{
+				++stats_.unknown_deallocations;
+			}
+		}
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+public:
+	BasicDynamicVectorMemoryResource()
+		: BasicDynamicVectorMemoryResource(DynamicVectorResourceOptions{}, std::pmr::get_default_resource()) {}
+
+	explicit BasicDynamicVectorMemoryResource(std::pmr::memory_resource *upstream)
+		: BasicDynamicVectorMemoryResource(DynamicVectorResourceOptions{}, upstream) {}
+
+	explicit BasicDynamicVectorMemoryResource(const DynamicVectorResourceOptions &options)
+		: BasicDynamicVectorMemoryResource(options, std::pmr::get_default_resource()) {}
+
+	BasicDynamicVectorMemoryResource(const DynamicVectorResourceOptions &options, std::pmr::memory_resource *upstream)
+		: options_(options), upstream_(upstream), blocks_(upstream), small_lists_(upstream), large_lists_(upstream),
+		  chunks_(upstream), index_(upstream) {}
+
+	BasicDynamicVectorMemoryResource(const BasicDynamicVectorMemoryResource &) = delete;
+	BasicDynamicVectorMemoryResource &operator=(const BasicDynamicVectorMemoryResource &) = delete;
+
+	const DynamicVectorResourceOptions &options() const noexcept
+	{
+		return options_;
+	}
+
+	std::pmr::memory_resource *upstream_resource() const noexcept
+	{
+		return upstream_;
+	}
+
+	const AllocationStats &stats() const noexcept
+		requires Stats::enabled
+	{
+		return stats_;
+	}
+
+	// Ресурс, выделивший блок p; читает только заголовок блока, поэтому p должен
+	// быть получен от ресурса в режиме заголовков.
+	static const void *owner_of(void *p) noexcept
+		requires intrusive
+	{
+		return header_of(p)->owner;
+	}
+
+	// В режиме заголовков сюда входят заголовки всех блоков вместе с выравнивающими отступами.
+	std::size_t metadata_bytes() const noexcept
+	{
+		return header_bytes_ +
+			   blocks_.capacity() * sizeof(BlockInfo) +
+			   index_.capacity() * sizeof(std::size_t) +
+			   (small_lists_.capacity() + large_lists_.capacity()) * sizeof(FreeList) +
+			   chunks_.capacity() * sizeof(ChunkInfo) +
+			   (intrusive ? 0 : chunks_.size() * chunk_bitmap_words() * sizeof(std::uint64_t));
+	}
+
+	// Возвращает вышестоящему ресурсу всю память, включая ещё не освобождённые блоки.
+	// После вызова ресурс пуст и пригоден для дальнейшей работы.
+	void release() noexcept
+	{
+		while (direct_head_ != nullptr)
+			release_direct(payload_of(direct_head_));
+		for (auto &block : blocks_)
+		{
+			upstream_->deallocate(block.ptr, block.size, block.alignment);
+		}
+		for (auto &chunk : chunks_)
+		{
+			upstream_->deallocate(chunk.ptr, chunk.size, alignof(std::max_align_t));
+			if (chunk.live_bits != nullptr)
+				upstream_->deallocate(chunk.live_bits, chunk_bitmap_words() * sizeof(std::uint64_t), alignof(std::uint64_t));
+		}
+		blocks_.clear();
+		blocks_.shrink_to_fit();
+		index_.clear();
+		index_.shrink_to_fit();
+		chunks_.clear();
+		chunks_.shrink_to_fit();
+		small_lists_.clear();
+		small_lists_.shrink_to_fit();
+		large_lists_.clear();
+		large_lists_.shrink_to_fit();
+		large_count_ = 0;
+		chunk_cursor_ = chunk_end_ = chunk_base_ = nullptr;
+		chunk_bits_ = nullptr;
+		next_chunk_ = 0;
+		live_blocks_ = cached_blocks_ = 0;
+		header_bytes_ = 0;
+		if constexpr (Stats::enabled)
+			stats_.live_bytes = 0;
+	}
+
+	// Считает все блоки освобождёнными, но сохраняет полученную память:
+	// чанки нарезаются заново, отдельные блоки уходят в списки свободных.
+	void reset() noexcept
+	{
+		for_each_free_list([](FreeList &list)
+						   { list.head = nullptr; });
+		chunk_cursor_ = chunk_end_ = chunk_base_ = nullptr;
+		chunk_bits_ = nullptr;
+		next_chunk_ = 0;
+		cached_blocks_ += live_blocks_;
+		live_blocks_ = 0;
+		if constexpr (Stats::enabled)
+			stats_.live_bytes = 0;
+		if constexpr (intrusive)
+		{
+			header_bytes_ = 0;
+			for (DirectLinks *links = direct_head_; links != nullptr; links = links->next)
+			{
+				void *p = payload_of(links);
+				BlockHeader *header = header_of(p);
+				const std::size_t alignment = std::size_t{1} << header->align_log2;
+				header->allocated = false;
+				header_bytes_ += direct_header_offset(alignment);
+				if (FreeList *list = find_free_list(header->size_units * size_granularity, alignment))
+					push_free(*list, p);
+			}
+		}
+		else
+		{
+			for (auto &block : blocks_)
+			{
+				block.allocated = false;
+				if (FreeList *list = find_free_list(block.size, block.alignment))
+					push_free(*list, block.ptr);
+			}
+			for (auto &chunk : chunks_)
+				std::fill_n(chunk.live_bits, chunk_bitmap_words(), std::uint64_t{0});
+		}
+	}
+
+	~BasicDynamicVectorMemoryResource()
+	{
+		release();
+	}
+};
+
+using DynamicVectorMemoryResource = BasicDynamicVectorMemoryResource<SideTableTracking>;
+using IntrusiveDynamicVectorMemoryResource = BasicDynamicVectorMemoryResource<IntrusiveHeaderTracking>;
+
+// Размер линии кэша, по которому разносятся данные разных потоков.
+inline constexpr std::size_t queue_cache_line_size = 64;
+
+// Потокобезопасный ресурс из нескольких IntrusiveDynamicVectorMemoryResource, каждый
+// под своим мьютексом. Поток при первом обращении закрепляется за шардом по кругу
+// и выделяет только из него; освобождение по заголовку блока уходит в шард-владелец,
+// так что блок, отданный другому потоку, возвращается туда, откуда был взят.
+// Шарды обращаются к upstream одновременно, поэтому он тоже должен быть потокобезопасным.
+class ShardedDynamicVectorMemoryResource : public std::pmr::memory_resource
+{
+private:
+	struct alignas(queue_cache_line_size) Shard
+	{
+		std::mutex mutex;
+		IntrusiveDynamicVectorMemoryResource resource;
+
+		Shard(const DynamicVectorResourceOptions &options, std::pmr::memory_resource *upstream)
+			: resource(options, upstream) {}
+	};
+
+	std::pmr::polymorphic_allocator<Shard> alloc_;
+	Shard *shards_;
+	std::size_t shard_count_;
+
+	static std::size_t default_shard_count() noexcept
+	{
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	Shard &local_shard() noexcept
+	{
+		static std::atomic<std::size_t> next_thread{0};
+		static thread_local const std::size_t thread_slot = next_thread.fetch_add(1, std::memory_order_relaxed);
+		return shards_[thread_slot % shard_count_];
+	}
+
+	// Шард, которому принадлежит ресурс owner, либо nullptr для чужого блока.
+	Shard *shard_of(const void *owner) const noexcept
+	{
+		const auto first = reinterpret_cast<std::uintptr_t>(&shards_[0].resource);
+		const auto addr = reinterpret_cast<std::uintptr_t>(owner);
+		if (addr < first || (addr - first) % sizeof(Shard) != 0 || (addr - first) / sizeof(Shard) >= shard_count_)
+			return nullptr;
+		return shards_ + (addr - first) / sizeof(Shard);
+	}
+
+protected:
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		Shard &shard = local_shard();
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		return shard.resource.allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+	{
+		Shard *shard = shard_of(IntrusiveDynamicVectorMemoryResource::owner_of(p));
+		if (shard == nullptr)
+			return;
+		std::lock_guard<std::mutex> lock(shard->mutex);
+		shard->resource.deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+public:
+	ShardedDynamicVectorMemoryResource()
+		: ShardedDynamicVectorMemoryResource(default_shard_count()) {}
+
+	// shard_count == 0 — по числу аппаратных потоков.
+	explicit ShardedDynamicVectorMemoryResource(std::size_t shard_count,
+												const DynamicVectorResourceOptions &options = {},
+												std::pmr::memory_resource *upstream = std::pmr::get_default_resource())
+		: alloc_(upstream), shards_(nullptr), shard_count_(shard_count == 0 ? default_shard_count() : shard_count)
+	{
+		shards_ = alloc_.allocate_object<Shard>(shard_count_);
+		std::size_t constructed = 0;
+		try
+		{
+			for (; constructed < shard_count_; ++constructed)
+				::new (static_cast<void *>(shards_ + constructed)) Shard(options, upstream);
+		}
+		catch (...)
+		{
+			std::destroy_n(shards_, constructed);
+			alloc_.deallocate_object(shards_, shard_count_);
+			throw;
+		}
+	}
+
+	ShardedDynamicVectorMemoryResource(const ShardedDynamicVectorMemoryResource &) = delete;
+	ShardedDynamicVectorMemoryResource &operator=(const ShardedDynamicVectorMemoryResource &) = delete;
+
+	~ShardedDynamicVectorMemoryResource()
+	{
+		std::destroy_n(shards_, shard_count_);
+		alloc_.deallocate_object(shards_, shard_count_);
+	}
+
+	std::size_t shard_count() const noexcept
+	{
+		return shard_count_;
+	}
+
+	std::pmr::memory_resource *upstream_resource() const noexcept
+	{
+		return alloc_.resource();
+	}
+
+	std::size_t metadata_bytes() const
+	{
+		std::size_t total = shard_count_ * sizeof(Shard);
+		for (std::size_t i = 0; i < shard_count_; ++i)
+		{
+			std::lock_guard<std::mutex> lock(shards_[i].mutex);
+			total += shards_[i].resource.metadata_bytes();
+		}
+		return total;
+	}
+
+	// Возвращает upstream всю память всех шардов; вызывается, когда ресурсом никто не пользуется.
+	void release() noexcept
+	{
+		for (std::size_t i = 0; i < shard_count_; ++i)
+			shards_[i].resource.release();
+	}
+};
+
+// Потокобезопасный кэширующий фронтенд для любого ресурса. Каждый поток держит
+// магазин недавно освобождённых блоков на класс размера (кратный 16 байтам, до
+// max_cached_size) и обращается к upstream под общим мьютексом только пачками:
+// когда магазин пуст или переполнен. Поэтому upstream может быть и
+// непотокобезопасным, например DynamicVectorMemoryResource.
+// Кэши принадлежат ресурсу и освобождаются вместе с ним; кэш завершившегося
+// потока достаётся следующему потоку с тем же std::thread::id.
+class ThreadCachingMemoryResource : public std::pmr::memory_resource
+{
+public:
+	static constexpr std::size_t max_cached_size = 512;
+	static constexpr std::size_t magazine_capacity = 32;
+
+private:
+	static constexpr std::size_t size_granularity = 16;
+	static constexpr std::size_t class_count = max_cached_size / size_granularity;
+	static constexpr std::size_t batch_size = magazine_capacity / 2;
+	static constexpr std::size_t local_slots = 4;
+
+	struct Magazine
+	{
+		std::array<void *, magazine_capacity> blocks;
+		std::size_t count = 0;
+	};
+
+	struct ThreadCache
+	{
+		std::thread::id owner;
+		std::array<Magazine, class_count> magazines{};
+	};
+
+	// Кэши нескольких ресурсов, которыми недавно пользовался поток.
+	// Идентификаторы ресурсов не переиспользуются, поэтому запись
+	// разрушенного ресурса просто никогда не совпадёт.
+	struct LocalSlot
+	{
+		std::uint64_t resource_id;
+		ThreadCache *cache;
+	};
+
+	std::pmr::memory_resource *upstream_;
+	std::uint64_t id_;
+	std::mutex mutex_;
+	std::pmr::vector<ThreadCache *> caches_;
+	std::size_t upstream_lock_count_ = 0;
+
+	static std::uint64_t next_id() noexcept
+	{
+		static std::atomic<std::uint64_t> counter{0};
+		return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
+	static std::size_t class_size(std::size_t index) noexcept
+	{
+		return (index + 1) * size_granularity;
+	}
+
+	static bool is_cached(std::size_t bytes, std::size_t alignment) noexcept
+	{
+		return bytes <= max_cached_size && alignment <= alignof(std::max_align_t);
+	}
+
+	static std::size_t class_index(std::size_t bytes) noexcept
+	{
+		return bytes == 0 ? 0 : (bytes - 1) / size_granularity;
+	}
+
+	ThreadCache *register_thread()
+	{
+		const std::thread::id self = std::this_thread::get_id();
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (ThreadCache *cache : caches_)
+		{
+			if (cache->owner == self)
+				return cache;
+		}
+		caches_.reserve(caches_.size() + 1);
+		std::pmr::polymorphic_allocator<ThreadCache> alloc(upstream_);
+		ThreadCache *cache = alloc.new_object<ThreadCache>();
+		cache->owner = self;
+		caches_.push_back(cache);
+		return cache;
+	}
+
+	ThreadCache &local_cache()
+	{
+		static thread_local std::array<LocalSlot, local_slots> slots{};
+		static thread_local std::size_t next_victim = 0;
+		for (const LocalSlot &slot : slots)
+		{
+			if (slot.resource_id == id_)
+				return *slot.cache;
+		}
+		ThreadCache *cache = register_thread();
+		slots[next_victim++ % local_slots] = {id_, cache};
+		return *cache;
+	}
+
+	void refill(Magazine &magazine, std::size_t index)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		++upstream_lock_count_;
+		try
+		{
+			while (magazine.count < batch_size)
+				magazine.blocks[magazine.count++] = upstream_->allocate(class_size(index), alignof(std::max_align_t));
+		}
+		catch (...)
+		{
+			if (magazine.count == 0)
+				throw;
+		}
+	}
+
+	// Возвращает upstream блоки магазина сверх keep.
+	void drain(Magazine &magazine, std::size_t index, std::size_t keep) noexcept
+	{
+		while (magazine.count > keep)
+			upstream_->deallocate(magazine.blocks[--magazine.count], class_size(index), alignof(std::max_align_t));
+	}
+
+protected:
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		if (!is_cached(bytes, alignment))
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			++upstream_lock_count_;
+			return upstream_->allocate(bytes, alignment);
+		}
+		const std::size_t index = class_index(bytes);
+		Magazine &magazine = local_cache().magazines[index];
+		if (magazine.count == 0)
+			refill(magazine, index);
+		return magazine.blocks[--magazine.count];
+	}
+
+	void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+	{
+		std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+		if (!is_cached(bytes, alignment))
+		{
+			lock.lock();
+			++upstream_lock_count_;
+			upstream_->deallocate(p, bytes, alignment);
+			return;
+		}
+		const std::size_t index = class_index(bytes);
+		Magazine &magazine = local_cache().magazines[index];
+		if (magazine.count == magazine_capacity)
+		{
+			lock.lock();
+			++upstream_lock_count_;
+			drain(magazine, index, magazine_capacity - batch_size);
+		}
+		magazine.blocks[magazine.count++] = p;
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+
+public:
+	ThreadCachingMemoryResource()
+		: ThreadCachingMemoryResource(std::pmr::get_default_resource()) {}
+
+	explicit ThreadCachingMemoryResource(std::pmr::memory_resource *upstream)
+		: upstream_(upstream), id_(next_id()), caches_(upstream) {}
+
+	ThreadCachingMemoryResource(const ThreadCachingMemoryResource &) = delete;
+	ThreadCachingMemoryResource &operator=(const ThreadCachingMemoryResource &) = delete;
+
+	// Вызывается, когда ресурсом никто не пользуется.
+	~ThreadCachingMemoryResource()
+	{
+		std::pmr::polymorphic_allocator<ThreadCache> alloc(upstream_);
+		for (ThreadCache *cache : caches_)
+		{
+			for (std::size_t i = 0; i < class_count; ++i)
+				drain(cache->magazines[i], i, 0);
+			alloc.delete_object(cache);
+		}
+	}
+
+	std::pmr::memory_resource *upstream_resource() const noexcept
+	{
+		return upstream_;
+	}
+
+	// Возвращает upstream все блоки из кэша вызывающего потока, например перед его завершением.
+	void flush_thread_cache()
+	{
+		ThreadCache &cache = local_cache();
+		std::lock_guard<std::mutex> lock(mutex_);
+		++upstream_lock_count_;
+		for (std::size_t i = 0; i < class_count; ++i)
+			drain(cache.magazines[i], i, 0);
+	}
+
+	// Сколько раз захватывался общий мьютекс ради обращения к upstream.
+	std::size_t upstream_lock_count()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return upstream_lock_count_;
+	}
+};
+
+
+template <typename T>
+struct QueueNode
+{
+	T value;
+	QueueNode *next;
+
+	// Элемент строится по протоколу uses-allocator: вложенные pmr-контейнеры
+	// получают ресурс очереди, как при polymorphic_allocator::construct.
+	template <typename... Args>
+	QueueNode(std::pmr::polymorphic_allocator<T> alloc, Args &&...args)
+		: value(std::make_obj_using_allocator<T>(alloc, std::forward<Args>(args)...)), next(nullptr) {}
+};
+
+template <typename T>
+class QueueIterator
+{
+	QueueNode<T> *node_;
+
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = T;
+	using difference_type = std::ptrdiff_t;
+	using pointer = T *;
+	using reference = T &;
+
+	explicit QueueIterator(QueueNode<T> *node = nullptr) : node_(node) {}
+
+	T &operator*() const { return node_->value; }
+	T *operator->() const { return &(node_->value); }
+
+	QueueIterator &operator++()
+	{
+		if (node_)
+			node_ = node_->next;
+		return *this;
+	}
+
+	QueueIterator operator++(int)
+	{
+		QueueIterator tmp = *this;
+		++(*this);
+		return tmp;
+	}
+
+	bool operator==(const QueueIterator &other) const
+	{
+		return node_ == other.node_;
+	}
+
+	bool operator!=(const QueueIterator &other) const
+	{
+		return !(*this == other);
+	}
+};
+
+template <typename T>
+class pmr_queue
+{
+private:
+	using Node = QueueNode<T>;
+	using Alloc = std::pmr::polymorphic_allocator<T>;
+	using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+
+	// Память узла в кэше: элемент уже разрушен, в начале хранится ссылка на следующий.
+	struct CachedNode
+	{
+		CachedNode *next;
+	};
+
+	static_assert(sizeof(Node) >= sizeof(CachedNode) && alignof(Node) >= alignof(CachedNode));
+
+	Node *head_ = nullptr;
+	Node *tail_ = nullptr;
+	std::size_t size_ = 0;
+	mutable Alloc alloc_;
+	CachedNode *cache_ = nullptr;
+	std::size_t cached_ = 0;
+	std::size_t cache_limit_ = 0;
+
+	Node *allocate_node()
+	{
+		if (cache_ != nullptr)
+		{
+			void *storage = std::exchange(cache_, cache_->next);
+			--cached_;
+			return static_cast<Node *>(storage);
+		}
+		NodeAlloc na(alloc_);
+		return std::allocator_traits<NodeAlloc>::allocate(na, 1);
+	}
+
+	void deallocate_node(Node *node) noexcept
+	{
+		if (cached_ < cache_limit_)
+		{
+			cache_ = ::new (static_cast<void *>(node)) CachedNode{cache_};
+			++cached_;
+			return;
+		}
+		NodeAlloc na(alloc_);
+		std::allocator_traits<NodeAlloc>::deallocate(na, node, 1);
+	}
+
+	void release_cache() noexcept
+	{
+		NodeAlloc na(alloc_);
+		while (cache_ != nullptr)
+		{
+			void *storage = std::exchange(cache_, cache_->next);
+			std::allocator_traits<NodeAlloc>::deallocate(na, static_cast<Node *>(storage), 1);
+		}
+		cached_ = 0;
+	}
+
+	template <typename... Args>
+	Node *create_node(Args &&...args)
+	{
+		NodeAlloc na(alloc_);
+		Node *node = allocate_node();
+		try
+		{
+			std::allocator_traits<NodeAlloc>::construct(na, node, alloc_, std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			deallocate_node(node);
+			throw;
+		}
+		return node;
+	}
+
+	void destroy_node(Node *node) noexcept
+	{
+		NodeAlloc na(alloc_);
+		std::allocator_traits<NodeAlloc>::destroy(na, node);
+		deallocate_node(node);
+	}
+
+	void link_back(Node *node) noexcept
+	{
+		if (tail_ == nullptr)
+		{
+			head_ = tail_ = node;
+		}
+		else
+		{
+			tail_->next = node;
+			tail_ = node;
+		}
+		++size_;
+	}
+
+	void pop_unchecked() noexcept
+	{
+		Node *tmp = head_;
+		head_ = head_->next;
+		if (head_ == nullptr)
+			tail_ = nullptr;
+		destroy_node(tmp);
+		--size_;
+	}
+
+	void steal(pmr_queue &other) noexcept
+	{
+		head_ = std::exchange(other.head_, nullptr);
+		tail_ = std::exchange(other.tail_, nullptr);
+		size_ = std::exchange(other.size_, 0);
+	}
+
+	// Поэлементный перенос для очередей на разных ресурсах; источник опустошается.
+	void move_elements_from(pmr_queue &other)
+	{
+		for (Node *node = other.head_; node != nullptr; node = node->next)
+			emplace(std::move(node->value));
+		other.clear();
+	}
+
+public:
+	using value_type = T;
+	using allocator_type = std::pmr::polymorphic_allocator<T>;
+	using iterator = QueueIterator<T>;
+
+	explicit pmr_queue(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+		: alloc_(mr) {}
+
+	pmr_queue(pmr_queue &&other) noexcept
+		: alloc_(other.alloc_)
+	{
+		steal(other);
+	}
+
+	// Узлы забираются за O(1), если ресурсы равны, иначе элементы переносятся по одному.
+	pmr_queue(pmr_queue &&other, std::pmr::memory_resource *mr)
+		: alloc_(mr)
+	{
+		if (alloc_ == other.alloc_)
+		{
+			steal(other);
+			return;
+		}
+		try
+		{
+			move_elements_from(other);
+		}
+		catch (...)
+		{
+			clear();
+			throw;
+		}
+	}
+
+	// Ресурс очереди при присваивании не меняется, как у всех pmr-контейнеров.
+	pmr_queue &operator=(pmr_queue &&other)
+	{
+		if (this == &other)
+			return *this;
+		clear();
+		if (alloc_ == other.alloc_)
+			steal(other);
+		else
+			move_elements_from(other);
+		return *this;
+	}
+
+	void swap(pmr_queue &other)
+	{
+		if (alloc_ == other.alloc_)
+		{
+			std::swap(head_, other.head_);
+			std::swap(tail_, other.tail_);
+			std::swap(size_, other.size_);
+			return;
+		}
+		pmr_queue tmp(std::move(*this), other.alloc_.resource());
+		*this = std::move(other);
+		other = std::move(tmp);
+	}
+
+	friend void swap(pmr_queue &a, pmr_queue &b)
+	{
+		a.swap(b);
+	}
+
+	allocator_type get_allocator() const noexcept
+	{
+		return alloc_;
+	}
+
+	~pmr_queue()
+	{
+		clear();
+		release_cache();
+	}
+
+	// Кэш узлов: до limit освобождённых узлов остаются в очереди и
+	// переиспользуются следующими push() без обращения к ресурсу.
+	void set_node_cache_limit(std::size_t limit) noexcept
+	{
+		cache_limit_ = limit;
+		while (cached_ > cache_limit_)
+		{
+			void *storage = std::exchange(cache_, cache_->next);
+			--cached_;
+			NodeAlloc na(alloc_);
+			std::allocator_traits<NodeAlloc>::deallocate(na, static_cast<Node *>(storage), 1);
+		}
+	}
+
+	std::size_t node_cache_limit() const noexcept
+	{
+		return cache_limit_;
+	}
+
+	// Число элементов, которые поместятся без обращения к ресурсу.
+	std::size_t capacity() const noexcept
+	{
+		return size_ + cached_;
+	}
+
+	// Заранее выделяет узлы под n элементов и при необходимости поднимает лимит кэша.
+	void reserve(std::size_t n)
+	{
+		if (n <= capacity())
+			return;
+		cache_limit_ = std::max(cache_limit_, n - size_);
+		NodeAlloc na(alloc_);
+		while (capacity() < n)
+		{
+			Node *node = std::allocator_traits<NodeAlloc>::allocate(na, 1);
+			cache_ = ::new (static_cast<void *>(node)) CachedNode{cache_};
+			++cached_;
+		}
+	}
+
+	// Возвращает ресурсу все закэшированные узлы и отключает кэш.
+	void shrink_to_fit() noexcept
+	{
+		set_node_cache_limit(0);
+	}
+
+	void clear() noexcept
+	{
+		while (head_ != nullptr)
+		{
+			Node *tmp = head_;
+			head_ = head_->next;
+			destroy_node(tmp);
+		}
+		tail_ = nullptr;
+		size_ = 0;
+	}
+
+	// Опустошает очередь, не возвращая узлы ресурсу: память забирается разом
+	// через release()/reset() ресурса или его деструктор. Для тривиально
+	// разрушаемых T выполняется за O(1).
+	void discard() noexcept
+	{
+		if constexpr (!std::is_trivially_destructible_v<T>)
+		{
+			NodeAlloc na(alloc_);
+			for (Node *node = head_; node != nullptr; node = node->next)
+				std::allocator_traits<NodeAlloc>::destroy(na, node);
+		}
+		head_ = tail_ = nullptr;
+		size_ = 0;
+	}
+
+	// Конструирует элемент прямо в новом узле, без временного объекта.
+	template <typename... Args>
+	T &emplace(Args &&...args)
+	{
+		Node *newNode = create_node(std::forward<Args>(args)...);
+		link_back(newNode);
+		return newNode->value;
+	}
+
+	void push(const T &value)
+	{
+		emplace(value);
+	}
+
+	void push(T &&value)
+	{
+		emplace(std::move(value));
+	}
+
+	void pop()
+	{
+		if (head_ == nullptr)
+			throw std::runtime_error("pop from empty queue");
+		pop_unchecked();
+	}
+
+	// Варианты без исключений для опрашивающих потребителей: пустая очередь
+	// обрабатывается одной проверкой, а не раскруткой стека.
+	bool try_pop(T &out) noexcept(std::is_nothrow_move_assignable_v<T>)
+	{
+		if (head_ == nullptr)
+			return false;
+		out = std::move(head_->value);
+		pop_unchecked();
+		return true;
+	}
+
+	T *try_front() noexcept
+	{
+		return head_ == nullptr ? nullptr : &head_->value;
+	}
+
+	const T *try_front() const noexcept
+	{
+		return head_ == nullptr ? nullptr : &head_->value;
+	}
+
+	// Забирает значение из головы и освобождает её узел за один вызов.
+	std::optional<T> pop_front_value() noexcept(std::is_nothrow_move_constructible_v<T>)
+	{
+		if (head_ == nullptr)
+			return std::nullopt;
+		std::optional<T> value(std::move(head_->value));
+		pop_unchecked();
+		return value;
+	}
+
+	// Узлы пакета собираются в отдельную цепочку и присоединяются к хвосту
+	// одной операцией; при исключении очередь остаётся прежней.
+	template <std::ranges::input_range R>
+	void push_range(R &&range)
+	{
+		Node *first = nullptr;
+		Node *last = nullptr;
+		std::size_t count = 0;
+		try
+		{
+			for (auto &&value : range)
+			{
+				Node *node = create_node(std::forward<decltype(value)>(value));
+				if (last == nullptr)
+					first = node;
+				else
+					last->next = node;
+				last = node;
+				++count;
+			}
+		}
+		catch (...)
+		{
+			while (first != nullptr)
+				destroy_node(std::exchange(first, first->next));
+			throw;
+		}
+		if (first == nullptr)
+			return;
+		if (tail_ == nullptr)
+			head_ = first;
+		else
+			tail_->next = first;
+		tail_ = last;
+		size_ += count;
+	}
+
+	// Переносит все элементы other в хвост этой очереди. На равных ресурсах
+	// цепочка узлов присоединяется за O(1), иначе элементы переносятся по одному.
+	void splice_back(pmr_queue &other)
+	{
+		if (this == &other || other.head_ == nullptr)
+			return;
+		if (alloc_ != other.alloc_)
+		{
+			move_elements_from(other);
+			return;
+		}
+		if (tail_ == nullptr)
+			head_ = other.head_;
+		else
+			tail_->next = other.head_;
+		tail_ = other.tail_;
+		size_ += other.size_;
+		other.head_ = other.tail_ = nullptr;
+		other.size_ = 0;
+	}
+
+	// Отделяет до n первых элементов в новую очередь на том же ресурсе без перевыделения узлов.
+	pmr_queue split_front(std::size_t n)
+	{
+		pmr_queue front_part(alloc_.resource());
+		n = std::min(n, size_);
+		if (n == 0)
+			return front_part;
+		Node *last = head_;
+		for (std::size_t i = 1; i < n; ++i)
+			last = last->next;
+		front_part.head_ = head_;
+		front_part.tail_ = last;
+		front_part.size_ = n;
+		head_ = last->next;
+		if (head_ == nullptr)
+			tail_ = nullptr;
+		last->next = nullptr;
+		size_ -= n;
+		return front_part;
+	}
+
+	// Отцепляет до n элементов с головы одной операцией и освобождает их; возвращает число удалённых.
+	std::size_t pop_n(std::size_t n) noexcept
+	{
+		n = std::min(n, size_);
+		if (n == 0)
+			return 0;
+		Node *first = head_;
+		Node *last = head_;
+		for (std::size_t i = 1; i < n; ++i)
+			last = last->next;
+		head_ = last->next;
+		if (head_ == nullptr)
+			tail_ = nullptr;
+		size_ -= n;
+		last->next = nullptr;
+		while (first != nullptr)
+			destroy_node(std::exchange(first, first->next));
+		return n;
+	}
+
+	// Перемещает до n элементов с головы в out и освобождает их узлы.
+	template <typename OutputIt>
+	OutputIt drain_into(OutputIt out, std::size_t n = static_cast<std::size_t>(-1))
+	{
+		for (; n != 0 && head_ != nullptr; --n)
+		{
+			*out = std::move(head_->value);
+			++out;
+			pop_unchecked();
+		}
+		return out;
+	}
+
+	T &front()
+	{
+		if (head_ == nullptr)
+			throw std::runtime_error("front of empty queue");
+		return head_->value;
+	}
+
+	const T &front() const
+	{
+		if (head_ == nullptr)
+			throw std::runtime_error("front of empty queue");
+		return head_->value;
+	}
+
+	bool empty() const noexcept
+	{
+		return head_ == nullptr;
+	}
+
+	std::size_t size() const noexcept
+	{
+		return size_;
+	}
+
+	iterator begin() const { return iterator(head_); }
+	iterator end() const { return iterator(nullptr); }
+
+	pmr_queue(const pmr_queue &) = delete;
+	pmr_queue &operator=(const pmr_queue &) = delete;
+};
+
+template <typename T, std::size_t N>
+struct QueueSegment
+{
+	alignas(T) std::byte storage[N * sizeof(T)];
+	QueueSegment *next;
+
+	QueueSegment() : next(nullptr) {}
+
+	T *slot(std::size_t i) noexcept
+	{
+		return std::launder(reinterpret_cast<T *>(storage + i * sizeof(T)));
+	}
+};
+
+template <typename T, std::size_t N>
+class SegmentedQueueIterator
+{
+	QueueSegment<T, N> *segment_;
+	std::size_t index_;
+
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = T;
+	using difference_type = std::ptrdiff_t;
+	using pointer = T *;
+	using reference = T &;
+
+	explicit SegmentedQueueIterator(QueueSegment<T, N> *segment = nullptr, std::size_t index = 0)
+		: segment_(segment), index_(index) {}
+
+	T &operator*() const { return *segment_->slot(index_); }
+	T *operator->() const { return segment_->slot(index_); }
+
+	SegmentedQueueIterator &operator++()
+	{
+		if (++index_ == N && segment_->next != nullptr)
+		{
+			segment_ = segment_->next;
+			index_ = 0;
+		}
+		return *this;
+	}
+
+	SegmentedQueueIterator operator++(int)
+	{
+		SegmentedQueueIterator tmp = *this;
+		++(*this);
+		return tmp;
+	}
+
+	bool operator==(const SegmentedQueueIterator &other) const
+	{
+		return segment_ == other.segment_ && index_ == other.index_;
+	}
+
+	bool operator!=(const SegmentedQueueIterator &other) const
+	{
+		return !(*this == other);
+	}
+};
+
+// Очередь, хранящая до N элементов в одном сегменте: один вызов ресурса
+// на N элементов и последовательный обход памяти.
+template <typename T, std::size_t N = std::max<std::size_t>(16, 512 / sizeof(T))>
+class pmr_segmented_queue
+{
+	static_assert(N > 0, "segment must hold at least one element");
+
+private:
+	using Segment = QueueSegment<T, N>;
+	using Alloc = std::pmr::polymorphic_allocator<T>;
+	using SegmentAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Segment>;
+
+	Segment *head_ = nullptr;
+	Segment *tail_ = nullptr;
+	std::size_t head_index_ = 0;
+	std::size_t tail_index_ = 0;
+	std::size_t size_ = 0;
+	mutable Alloc alloc_;
+
+	Segment *allocate_segment()
+	{
+		SegmentAlloc sa(alloc_);
+		Segment *segment = std::allocator_traits<SegmentAlloc>::allocate(sa, 1);
+		return ::new (static_cast<void *>(segment)) Segment();
+	}
+
+	void free_segment(Segment *segment) noexcept
+	{
+		SegmentAlloc sa(alloc_);
+		std::allocator_traits<SegmentAlloc>::deallocate(sa, segment, 1);
+	}
+
+	void pop_unchecked() noexcept
+	{
+		std::allocator_traits<Alloc>::destroy(alloc_, head_->slot(head_index_));
+		++head_index_;
+		--size_;
+		if (size_ == 0)
+		{
+			// Пустая очередь держит ровно один сегмент, и он же хвостовой.
+			for (Segment *segment = head_->next; segment != nullptr;)
+			{
+				Segment *next = segment->next;
+				free_segment(segment);
+				segment = next;
+			}
+			head_->next = nullptr;
+			tail_ = head_;
+			head_index_ = tail_index_ = 0;
+		}
+		else if (head_index_ == N)
+		{
+			Segment *segment = head_;
+			head_ = head_->next;
+			head_index_ = 0;
+			free_segment(segment);
+		}
+	}
+
+public:
+	using value_type = T;
+	using iterator = SegmentedQueueIterator<T, N>;
+
+	static constexpr std::size_t segment_capacity = N;
+
+	explicit pmr_segmented_queue(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+		: alloc_(mr) {}
+
+	~pmr_segmented_queue()
+	{
+		clear();
+		if (head_ != nullptr)
+			free_segment(head_);
+	}
+
+	// Разрушает элементы; один пустой сегмент остаётся для следующих push().
+	void clear() noexcept
+	{
+		while (size_ != 0)
+			pop_unchecked();
+	}
+
+	// Новый сегмент подключается к очереди только после того, как в нём
+	// сконструирован элемент, поэтому исключение конструктора её не меняет.
+	template <typename... Args>
+	T &emplace(Args &&...args)
+	{
+		if (tail_ != nullptr && tail_index_ < N)
+		{
+			T *slot = tail_->slot(tail_index_);
+			std::allocator_traits<Alloc>::construct(alloc_, slot, std::forward<Args>(args)...);
+			++tail_index_;
+			++size_;
+			return *slot;
+		}
+
+		Segment *segment = allocate_segment();
+		T *slot = segment->slot(0);
+		try
+		{
+			std::allocator_traits<Alloc>::construct(alloc_, slot, std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			free_segment(segment);
+			throw;
+		}
+		if (tail_ == nullptr)
+			head_ = segment;
+		else
+			tail_->next = segment;
+		tail_ = segment;
+		tail_index_ = 1;
+		++size_;
+		return *slot;
+	}
+
+	void push(const T &value)
+	{
+		emplace(value);
+	}
+
+	void push(T &&value)
+	{
+		emplace(std::move(value));
+	}
+
+	void pop()
+	{
+		if (size_ == 0)
+			throw std::runtime_error("pop from empty queue");
+		pop_unchecked();
+	}
+
+	T &front()
+	{
+		if (size_ == 0)
+			throw std::runtime_error("front of empty queue");
+		return *head_->slot(head_index_);
+	}
+
+	const T &front() const
+	{
+		if (size_ == 0)
+			throw std::runtime_error("front of empty queue");
+		return *head_->slot(head_index_);
+	}
+
+	bool empty() const noexcept
+	{
+		return size_ == 0;
+	}
+
+	std::size_t size() const noexcept
+	{
+		return size_;
+	}
+
+	iterator begin() const { return iterator(head_, head_index_); }
+	iterator end() const { return iterator(tail_, tail_index_); }
+
+	pmr_segmented_queue(const pmr_segmented_queue &) = delete;
+	pmr_segmented_queue &operator=(const pmr_segmented_queue &) = delete;
+	pmr_segmented_queue(pmr_segmented_queue &&) = delete;
+	pmr_segmented_queue &operator=(pmr_segmented_queue &&) = delete;
+};
+
+template <typename T>
+class RingQueueIterator
+{
+	T *data_;
+	std::size_t mask_;
+	std::size_t pos_;
+
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = T;
+	using difference_type = std::ptrdiff_t;
+	using pointer = T *;
+	using reference = T &;
+
+	explicit RingQueueIterator(T *data = nullptr, std::size_t mask = 0, std::size_t pos = 0)
+		: data_(data), mask_(mask), pos_(pos) {}
+
+	T &operator*() const { return data_[pos_ & mask_]; }
+	T *operator->() const { return data_ + (pos_ & mask_); }
+
+	RingQueueIterator &operator++()
+	{
+		++pos_;
+		return *this;
+	}
+
+	RingQueueIterator operator++(int)
+	{
+		RingQueueIterator tmp = *this;
+		++(*this);
+		return tmp;
+	}
+
+	bool operator==(const RingQueueIterator &other) const
+	{
+		return data_ == other.data_ && pos_ == other.pos_;
+	}
+
+	bool operator!=(const RingQueueIterator &other) const
+	{
+		return !(*this == other);
+	}
+};
+
+// Очередь на непрерывном кольцевом буфере; ёмкость — степень двойки и растёт вдвое.
+template <typename T>
+class pmr_ring_queue
+{
+private:
+	using Alloc = std::pmr::polymorphic_allocator<T>;
+
+	T *data_ = nullptr;
+	std::size_t capacity_ = 0;
+	std::size_t head_ = 0;
+	std::size_t size_ = 0;
+	mutable Alloc alloc_;
+
+	static constexpr std::size_t min_capacity = 8;
+
+	T *slot(std::size_t logical) const noexcept
+	{
+		return data_ + ((head_ + logical) & (capacity_ - 1));
+	}
+
+	// Переносит элементы в начало нового буфера; при исключении новый буфер остаётся пустым.
+	void move_elements_to(T *data)
+	{
+		std::size_t moved = 0;
+		try
+		{
+			for (; moved < size_; ++moved)
+				std::allocator_traits<Alloc>::construct(alloc_, data + moved, std::move_if_noexcept(*slot(moved)));
+		}
+		catch (...)
+		{
+			for (std::size_t i = 0; i < moved; ++i)
+				std::allocator_traits<Alloc>::destroy(alloc_, data + i);
+			throw;
+		}
+	}
+
+	void adopt(T *data, std::size_t capacity) noexcept
+	{
+		destroy_all();
+		if (data_ != nullptr)
+			std::allocator_traits<Alloc>::deallocate(alloc_, data_, capacity_);
+		data_ = data;
+		capacity_ = capacity;
+		head_ = 0;
+	}
+
+	void reallocate(std::size_t capacity)
+	{
+		T *data = std::allocator_traits<Alloc>::allocate(alloc_, capacity);
+		try
+		{
+			move_elements_to(data);
+		}
+		catch (...)
+		{
+			std::allocator_traits<Alloc>::deallocate(alloc_, data, capacity);
+			throw;
+		}
+		adopt(data, capacity);
+	}
+
+	void destroy_all() noexcept
+	{
+		for (std::size_t i = 0; i < size_; ++i)
+			std::allocator_traits<Alloc>::destroy(alloc_, slot(i));
+	}
+
+	// Новый элемент конструируется до переноса старых: аргументы могут ссылаться на элементы очереди.
+	template <typename... Args>
+	T &emplace_with_growth(Args &&...args)
+	{
+		const std::size_t capacity = capacity_ == 0 ? min_capacity : capacity_ * 2;
+		T *data = std::allocator_traits<Alloc>::allocate(alloc_, capacity);
+		try
+		{
+			std::allocator_traits<Alloc>::construct(alloc_, data + size_, std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			std::allocator_traits<Alloc>::deallocate(alloc_, data, capacity);
+			throw;
+		}
+		try
+		{
+			move_elements_to(data);
+		}
+		catch (...)
+		{
+			std::allocator_traits<Alloc>::destroy(alloc_, data + size_);
+			std::allocator_traits<Alloc>::deallocate(alloc_, data, capacity);
+			throw;
+		}
+		adopt(data, capacity);
+		return data_[size_++];
+	}
+
+public:
+	using value_type = T;
+	using iterator = RingQueueIterator<T>;
+
+	explicit pmr_ring_queue(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+		: alloc_(mr) {}
+
+	~pmr_ring_queue()
+	{
+		destroy_all();
+		if (data_ != nullptr)
+			std::allocator_traits<Alloc>::deallocate(alloc_, data_, capacity_);
+	}
+
+	void clear() noexcept
+	{
+		destroy_all();
+		head_ = 0;
+		size_ = 0;
+	}
+
+	void reserve(std::size_t n)
+	{
+		if (n <= capacity_)
+			return;
+		std::size_t capacity = std::max(capacity_, min_capacity);
+		while (capacity < n)
+			capacity *= 2;
+		reallocate(capacity);
+	}
+
+	std::size_t capacity() const noexcept
+	{
+		return capacity_;
+	}
+
+	template <typename... Args>
+	T &emplace(Args &&...args)
+	{
+		if (size_ == capacity_)
+			return emplace_with_growth(std::forward<Args>(args)...);
+		T *p = slot(size_);
+		std::allocator_traits<Alloc>::construct(alloc_, p, std::forward<Args>(args)...);
+		++size_;
+		return *p;
+	}
+
+	void push(const T &value)
+	{
+		emplace(value);
+	}
+
+	void push(T &&value)
+	{
+		emplace(std::move(value));
+	}
+
+	void pop()
+	{
+		if (size_ == 0)
+			throw std::runtime_error("pop from empty queue");
+		std::allocator_traits<Alloc>::destroy(alloc_, data_ + head_);
+		head_ = (head_ + 1) & (capacity_ - 1);
+		--size_;
+	}
+
+	T &front()
+	{
+		if (size_ == 0)
+			throw std::runtime_error("front of empty queue");
+		return data_[head_];
+	}
+
+	const T &front() const
+	{
+		if (size_ == 0)
+			throw std::runtime_error("front of empty queue");
+		return data_[head_];
+	}
+
+	bool empty() const noexcept
+	{
+		return size_ == 0;
+	}
+
+	std::size_t size() const noexcept
+	{
+		return size_;
+	}
+
+	iterator begin() const { return iterator(data_, capacity_ - 1, head_); }
+	iterator end() const { return iterator(data_, capacity_ - 1, head_ + size_); }
+
+	pmr_ring_queue(const pmr_ring_queue &) = delete;
+	pmr_ring_queue &operator=(const pmr_ring_queue &) = delete;
+	pmr_ring_queue(pmr_ring_queue &&) = delete;
+	pmr_ring_queue &operator=(pmr_ring_queue &&) = delete;
+};
+
+template <typename T, std::size_t K>
+class SmallQueueIterator
+{
+	T *inline_;
+	std::size_t head_;
+	std::size_t index_;
+	std::size_t inline_size_;
+	QueueIterator<T> overflow_;
+
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = T;
+	using difference_type = std::ptrdiff_t;
+	using pointer = T *;
+	using reference = T &;
+
+	SmallQueueIterator() : inline_(nullptr), head_(0), index_(0), inline_size_(0) {}
+
+	SmallQueueIterator(T *inline_storage, std::size_t head, std::size_t index, std::size_t inline_size,
+					   QueueIterator<T> overflow)
+		: inline_(inline_storage), head_(head), index_(index), inline_size_(inline_size), overflow_(overflow) {}
+
+	T &operator*() const { return index_ < inline_size_ ? inline_[(head_ + index_) % K] : *overflow_; }
+	T *operator->() const { return &**this; }
+
+	SmallQueueIterator &operator++()
+	{
+		if (index_ < inline_size_)
+			++index_;
+		else
+			++overflow_;
+		return *this;
+	}
+
+	SmallQueueIterator operator++(int)
+	{
+		SmallQueueIterator tmp = *this;
+		++(*this);
+		return tmp;
+	}
+
+	bool operator==(const SmallQueueIterator &other) const
+	{
+		return index_ == other.index_ && overflow_ == other.overflow_;
+	}
+
+	bool operator!=(const SmallQueueIterator &other) const
+	{
+		return !(*this == other);
+	}
+};
+
+// Очередь с первыми K элементами внутри самого объекта: к ресурсу обращается
+// только при переполнении. Встроенные элементы всегда старше вытесненных.
+template <typename T, std::size_t K = 16>
+class pmr_small_queue
+{
+	static_assert(K > 0, "inline capacity must be positive");
+
+private:
+	using Alloc = std::pmr::polymorphic_allocator<T>;
+
+	alignas(T) std::byte storage_[K * sizeof(T)];
+	std::size_t inline_head_ = 0;
+	std::size_t inline_size_ = 0;
+	pmr_queue<T> overflow_;
+
+	T *inline_data() noexcept
+	{
+		return std::launder(reinterpret_cast<T *>(storage_));
+	}
+
+	const T *inline_data() const noexcept
+	{
+		return std::launder(reinterpret_cast<const T *>(storage_));
+	}
+
+	T *inline_slot(std::size_t logical) noexcept
+	{
+		return inline_data() + (inline_head_ + logical) % K;
+	}
+
+public:
+	using value_type = T;
+	using iterator = SmallQueueIterator<T, K>;
+
+	static constexpr std::size_t inline_capacity = K;
+
+	explicit pmr_small_queue(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+		: overflow_(mr) {}
+
+	~pmr_small_queue()
+	{
+		clear();
+	}
+
+	void clear() noexcept
+	{
+		Alloc alloc = overflow_.get_allocator();
+		for (std::size_t i = 0; i < inline_size_; ++i)
+			std::allocator_traits<Alloc>::destroy(alloc, inline_slot(i));
+		inline_head_ = inline_size_ = 0;
+		overflow_.clear();
+	}
+
+	template <typename... Args>
+	T &emplace(Args &&...args)
+	{
+		if (inline_size_ == K || !overflow_.empty())
+			return overflow_.emplace(std::forward<Args>(args)...);
+		Alloc alloc = overflow_.get_allocator();
+		T *slot = inline_slot(inline_size_);
+		std::allocator_traits<Alloc>::construct(alloc, slot, std::forward<Args>(args)...);
+		++inline_size_;
+		return *slot;
+	}
+
+	void push(const T &value)
+	{
+		emplace(value);
+	}
+
+	void push(T &&value)
+	{
+		emplace(std::move(value));
+	}
+
+	void pop()
+	{
+		if (inline_size_ == 0)
+		{
+			overflow_.pop();
+			return;
+		}
+		Alloc alloc = overflow_.get_allocator();
+		std::allocator_traits<Alloc>::destroy(alloc, inline_slot(0));
+		inline_head_ = (inline_head_ + 1) % K;
+		--inline_size_;
+	}
+
+	T &front()
+	{
+		return inline_size_ != 0 ? *inline_slot(0) : overflow_.front();
+	}
+
+	const T &front() const
+	{
+		return inline_size_ != 0 ? inline_data()[inline_head_] : overflow_.front();
+	}
+
+	bool empty() const noexcept
+	{
+		return inline_size_ == 0 && overflow_.empty();
+	}
+
+	std::size_t size() const noexcept
+	{
+		return inline_size_ + overflow_.size();
+	}
+
+	// Число элементов, лежащих во встроенном буфере.
+	std::size_t inline_size() const noexcept
+	{
+		return inline_size_;
+	}
+
+	iterator begin() const
+	{
+		return iterator(const_cast<T *>(inline_data()), inline_head_, 0, inline_size_, overflow_.begin());
+	}
+
+	iterator end() const
+	{
+		return iterator(const_cast<T *>(inline_data()), inline_head_, inline_size_, inline_size_, overflow_.end());
+	}
+
+	pmr_small_queue(const pmr_small_queue &) = delete;
+	pmr_small_queue &operator=(const pmr_small_queue &) = delete;
+	pmr_small_queue(pmr_small_queue &&) = delete;
+	pmr_small_queue &operator=(pmr_small_queue &&) = delete;
+};
+
+// Ограниченная wait-free очередь для одного производителя и одного потребителя.
+// Буфер выделяется один раз при создании, поэтому сам ресурс не обязан быть потокобезопасным.
+template <typename T>
+class pmr_spsc_queue
+{
+private:
+	using Alloc = std::pmr::polymorphic_allocator<T>;
+
+	// Индексы растут монотонно; позиция в буфере — индекс по маске.
+	// Каждый поток держит кэшированную копию чужого индекса на своей линии.
+	alignas(queue_cache_line_size) std::atomic<std::size_t> head_{0};
+	std::size_t cached_tail_ = 0;
+
+	alignas(queue_cache_line_size) std::atomic<std::size_t> tail_{0};
+	std::size_t cached_head_ = 0;
+
+	alignas(queue_cache_line_size) T *data_;
+	std::size_t capacity_;
+	Alloc alloc_;
+
+	static std::size_t round_capacity(std::size_t capacity)
+	{
+		if (capacity == 0)
+			throw std::invalid_argument("queue capacity must be positive");
+		return std::bit_ceil(capacity);
+	}
+
+public:
+	using value_type = T;
+
+	explicit pmr_spsc_queue(std::size_t capacity, std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+		: data_(nullptr), capacity_(round_capacity(capacity)), alloc_(mr)
+	{
+		data_ = std::allocator_traits<Alloc>::allocate(alloc_, capacity_);
+	}
+
+	~pmr_spsc_queue()
+	{
+		const std::size_t tail = tail_.load(std::memory_order_relaxed);
+		for (std::size_t i = head_.load(std::memory_order_relaxed); i != tail; ++i)
+			std::allocator_traits<Alloc>::destroy(alloc_, data_ + (i & (capacity_ - 1)));
+		std::allocator_traits<Alloc>::deallocate(alloc_, data_, capacity_);
+	}
+
+	// Вызывается только потоком-производителем; false — очередь заполнена.
+	template <typename... Args>
+	bool try_emplace(Args &&...args)
+	{
+		const std::size_t tail = tail_.load(std::memory_order_relaxed);
+		if (tail - cached_head_ == capacity_)
+		{
+			cached_head_ = head_.load(std::memory_order_acquire);
+			if (tail - cached_head_ == capacity_)
+				return false;
+		}
+		std::allocator_traits<Alloc>::construct(alloc_, data_ + (tail & (capacity_ - 1)), std::forward<Args>(args)...);
+		tail_.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool try_push(const T &value)
+	{
+		return try_emplace(value);
+	}
+
+	bool try_push(T &&value)
+	{
+		return try_emplace(std::move(value));
+	}
+
+	// Вызывается только потоком-потребителем; false — очередь пуста.
+	bool try_pop(T &out) noexcept(std::is_nothrow_move_assignable_v<T>)
+	{
+		const std::size_t head = head_.load(std::memory_order_relaxed);
+		if (head == cached_tail_)
+		{
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+			if (head == cached_tail_)
+				return false;
+		}
+		T *slot = data_ + (head & (capacity_ - 1));
+		out = std::move(*slot);
+		std::allocator_traits<Alloc>::destroy(alloc_, slot);
+		head_.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Приблизительные значения, если очередь одновременно используется другим потоком.
+	bool empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	std::size_t size() const noexcept
+	{
+		const std::size_t head = head_.load(std::memory_order_acquire);
+		return tail_.load(std::memory_order_acquire) - head;
+	}
+
+	std::size_t capacity() const noexcept
+	{
+		return capacity_;
+	}
+
+	pmr_spsc_queue(const pmr_spsc_queue &) = delete;
+	pmr_spsc_queue &operator=(const pmr_spsc_queue &) = delete;
+};
+
+template <typename T>
+struct ConcurrentQueueNode
+{
+	alignas(T) std::byte storage[sizeof(T)];
+	std::atomic<ConcurrentQueueNode *> next{nullptr};
+
+	T *value() noexcept
+	{
+		return std::launder(reinterpret_cast<T *>(storage));
+	}
+};
+
+// Неограниченная lock-free очередь Майкла–Скотта для нескольких производителей
+// и потребителей. Узлы освобождаются через hazard pointers, поэтому ресурс
+// должен быть потокобезопасным (например, std::pmr::synchronized_pool_resource).
+template <typename T>
+class pmr_mpmc_queue
+{
+private:
+	using Node = ConcurrentQueueNode<T>;
+	using Alloc = std::pmr::polymorphic_allocator<T>;
+
+	static constexpr std::size_t hazard_records = 128;
+	static constexpr std::size_t retire_threshold = 4 * hazard_records;
+
+	// Запись захватывается потоком на время одной операции; список отложенных
+	// узлов принадлежит записи и трогается только её текущим владельцем.
+	// Память под список берётся при первом try_pop() через эту запись.
+	struct alignas(queue_cache_line_size) HazardRecord
+	{
+		std::atomic<bool> active{false};
+		std::atomic<Node *> hazards[2] = {};
+		std::pmr::vector<Node *> retired;
+
+		explicit HazardRecord(std::pmr::memory_resource *mr) : retired(mr) {}
+	};
+
+	class RecordGuard
+	{
+		HazardRecord *record_;
+
+	public:
+		explicit RecordGuard(pmr_mpmc_queue &queue) : record_(queue.acquire_record()) {}
+
+		~RecordGuard()
+		{
+			record_->hazards[0].store(nullptr, std::memory_order_release);
+			record_->hazards[1].store(nullptr, std::memory_order_release);
+			record_->active.store(false, std::memory_order_release);
+		}
+
+		HazardRecord *operator->() const noexcept { return record_; }
+
+		RecordGuard(const RecordGuard &) = delete;
+		RecordGuard &operator=(const RecordGuard &) = delete;
 	};
 
-	std::vector<BlockInfo> blocks_;
+	alignas(queue_cache_line_size) std::atomic<Node *> head_;
+	alignas(queue_cache_line_size) std::atomic<Node *> tail_;
+	alignas(queue_cache_line_size) std::atomic<std::size_t> size_{0};
+	Alloc alloc_;
+	HazardRecord *records_;
 
-	auto find_block(void *p)
+	Node *allocate_node()
 	{
-		return std::find_if(blocks_.begin(), blocks_.end(),
-							[p](const BlockInfo &b)
-							{ return b.ptr == p; });
+		Node *node = alloc_.template allocate_object<Node>();
+		return ::new (static_cast<void *>(node)) Node();
 	}
 
-protected:
-	void *do_allocate(std::size_t bytes, std::size_t alignment) override
+	void deallocate_node(Node *node) noexcept
 	{
-		void *ptr = ::operator new(bytes, std::align_val_t(alignment));
-		blocks_.push_back({ptr, bytes, alignment, true});
-		return ptr;
+		node->~Node();
+		alloc_.deallocate_object(node);
 	}
 
-	void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+	HazardRecord *acquire_record() noexcept
 	{
-		auto it = find_block(p);
-		if (it != blocks_.end())
+		static thread_local std::size_t hint = std::hash<std::thread::id>()(std::this_thread::get_id());
+		for (std::size_t i = 0;; ++i)
 		{
-			if (it->allocated)
+			HazardRecord &record = records_[(hint + i) % hazard_records];
+			bool expected = false;
+			if (!record.active.load(std::memory_order_relaxed) &&
+				record.active.compare_exchange_strong(expected, true, std::memory_order_acquire))
 			{
-				::operator delete(p, std::align_val_t(it->alignment));
-				it->allocated = false;
+				hint = (hint + i) % hazard_records;
+				return &record;
 			}
+			if (i % hazard_records == hazard_records - 1)
+				std::this_thread::yield();
 		}
 	}
 
-	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	static Node *protect(std::atomic<Node *> &hazard, const std::atomic<Node *> &source) noexcept
 	{
-		return this == &other;
+		Node *node = source.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			hazard.store(node, std::memory_order_seq_cst);
+			Node *current = source.load(std::memory_order_seq_cst);
+			if (current == node)
+				return node;
+			node = current;
+		}
+	}
+
+	void retire(HazardRecord &record, Node *node) noexcept
+	{
+		record.retired.push_back(node);
+		if (record.retired.size() < retire_threshold)
+			return;
+
+		std::array<Node *, 2 * hazard_records> protected_nodes;
+		std::size_t count = 0;
+		for (std::size_t i = 0; i < hazard_records; ++i)
+		{
+			for (auto &hazard : records_[i].hazards)
+			{
+				if (Node *p = hazard.load(std::memory_order_seq_cst))
+					protected_nodes[count++] = p;
+			}
+		}
+		std::sort(protected_nodes.begin(), protected_nodes.begin() + count);
+
+		auto keep = std::partition(record.retired.begin(), record.retired.end(),
+								   [&](Node *p)
+								   { return std::binary_search(protected_nodes.begin(), protected_nodes.begin() + count, p); });
+		for (auto it = keep; it != record.retired.end(); ++it)
+			deallocate_node(*it);
+		record.retired.erase(keep, record.retired.end());
 	}
 
 public:
-	~DynamicVectorMemoryResource()
+	using value_type = T;
+
+	explicit pmr_mpmc_queue(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+		: alloc_(mr), records_(nullptr)
 	{
-		for (auto &block : blocks_)
+		Node *dummy = allocate_node();
+		head_.store(dummy, std::memory_order_relaxed);
+		tail_.store(dummy, std::memory_order_relaxed);
+		std::size_t constructed = 0;
+		try
+		{
+			records_ = alloc_.template allocate_object<HazardRecord>(hazard_records);
+			for (; constructed < hazard_records; ++constructed)
+				::new (static_cast<void *>(records_ + constructed)) HazardRecord(mr);
+		}
+		catch (...)
 		{
-			if (block.allocated)
+			if (records_ != nullptr)
 			{
-				::operator delete(block.ptr, std::align_val_t(block.alignment));
+				std::destroy_n(records_, constructed);
+				alloc_.deallocate_object(records_, hazard_records);
 			}
+			deallocate_node(dummy);
+			throw;
 		}
 	}
-};
 
-template <typename T>
-struct QueueNode
-{
-	T value;
-	QueueNode *next;
+	// Вызывается, когда другие потоки уже не обращаются к очереди.
+	~pmr_mpmc_queue()
+	{
+		Node *node = head_.load(std::memory_order_relaxed);
+		Node *next = node->next.load(std::memory_order_relaxed);
+		deallocate_node(node);
+		for (node = next; node != nullptr; node = next)
+		{
+			next = node->next.load(std::memory_order_relaxed);
+			std::allocator_traits<Alloc>::destroy(alloc_, node->value());
+			deallocate_node(node);
+		}
+		for (std::size_t i = 0; i < hazard_records; ++i)
+		{
+			for (Node *retired : records_[i].retired)
+				deallocate_node(retired);
+		}
+		std::destroy_n(records_, hazard_records);
+		alloc_.deallocate_object(records_, hazard_records);
+	}
 
 	template <typename... Args>
-	QueueNode(std::pmr::polymorphic_allocator<T> alloc, Args &&...args)
-		: value(std::forward<Args>(args)...), next(nullptr) {}
+	void emplace(Args &&...args)
+	{
+		Node *node = allocate_node();
+		try
+		{
+			std::allocator_traits<Alloc>::construct(alloc_, node->value(), std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			deallocate_node(node);
+			throw;
+		}
+
+		// Счётчик растёт до того, как узел станет видим потребителям, иначе их
+		// fetch_sub мог бы опередить его и увести size() через ноль.
+		size_.fetch_add(1, std::memory_order_relaxed);
+		RecordGuard record(*this);
+		for (;;)
+		{
+			Node *tail = protect(record->hazards[0], tail_);
+			Node *next = tail->next.load(std::memory_order_acquire);
+			if (tail != tail_.load(std::memory_order_acquire))
+				continue;
+			if (next != nullptr)
+			{
+				tail_.compare_exchange_weak(tail, next, std::memory_order_release, std::memory_order_relaxed);
+				continue;
+			}
+			Node *expected = nullptr;
+			if (tail->next.compare_exchange_weak(expected, node, std::memory_order_release, std::memory_order_relaxed))
+			{
+				tail_.compare_exchange_strong(tail, node, std::memory_order_release, std::memory_order_relaxed);
+				return;
+			}
+		}
+	}
+
+	void push(const T &value)
+	{
+		emplace(value);
+	}
+
+	void push(T &&value)
+	{
+		emplace(std::move(value));
+	}
+
+	// false — очередь пуста в момент проверки.
+	bool try_pop(T &out)
+	{
+		RecordGuard record(*this);
+		// Резерв заранее, чтобы retire() не выделял память после извлечения узла.
+		if (record->retired.capacity() < retire_threshold)
+			record->retired.reserve(retire_threshold);
+		for (;;)
+		{
+			Node *head = protect(record->hazards[0], head_);
+			Node *tail = tail_.load(std::memory_order_acquire);
+			Node *next = head->next.load(std::memory_order_acquire);
+			record->hazards[1].store(next, std::memory_order_seq_cst);
+			if (head != head_.load(std::memory_order_seq_cst))
+				continue;
+			if (next == nullptr)
+				return false;
+			if (head == tail)
+			{
+				tail_.compare_exchange_weak(tail, next, std::memory_order_release, std::memory_order_relaxed);
+				continue;
+			}
+			if (head_.compare_exchange_strong(head, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+			{
+				// next стал фиктивным головным узлом; его значение забирает только победивший поток.
+				size_.fetch_sub(1, std::memory_order_relaxed);
+				T *value = next->value();
+				try
+				{
+					out = std::move(*value);
+				}
+				catch (...)
+				{
+					std::allocator_traits<Alloc>::destroy(alloc_, value);
+					retire(*record.operator->(), head);
+					throw;
+				}
+				std::allocator_traits<Alloc>::destroy(alloc_, value);
+				retire(*record.operator->(), head);
+				return true;
+			}
+		}
+	}
+
+	// Приблизительные значения при конкурентном доступе.
+	std::size_t size() const noexcept
+	{
+		return size_.load(std::memory_order_relaxed);
+	}
+
+	bool empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	pmr_mpmc_queue(const pmr_mpmc_queue &) = delete;
+	pmr_mpmc_queue &operator=(const pmr_mpmc_queue &) = delete;
 };
 
+// Ограниченная очередь Вьюкова для нескольких производителей и потребителей.
+// Массив ячеек выделяется один раз, в горячем пути нет ни выделений, ни блокировок:
+// каждая операция занимает ячейку одним CAS по счётчику позиций.
 template <typename T>
-class QueueIterator
+class pmr_bounded_mpmc_queue
 {
-	QueueNode<T> *node_;
+private:
+	using Alloc = std::pmr::polymorphic_allocator<T>;
+
+	static_assert(std::is_nothrow_move_constructible_v<T>, "pmr_bounded_mpmc_queue requires a nothrow move constructor");
+
+	// sequence == pos — ячейка свободна для записи с позиции pos,
+	// sequence == pos + 1 — в ячейке лежит значение для чтения с позиции pos.
+	struct Slot
+	{
+		std::atomic<std::size_t> sequence;
+		alignas(T) std::byte storage[sizeof(T)];
+
+		T *value() noexcept
+		{
+			return std::launder(reinterpret_cast<T *>(storage));
+		}
+	};
+
+	alignas(queue_cache_line_size) std::atomic<std::size_t> enqueue_pos_{0};
+	alignas(queue_cache_line_size) std::atomic<std::size_t> dequeue_pos_{0};
+	alignas(queue_cache_line_size) Slot *slots_;
+	std::size_t mask_;
+	Alloc alloc_;
+
+	static std::size_t round_capacity(std::size_t capacity)
+	{
+		if (capacity == 0)
+			throw std::invalid_argument("queue capacity must be positive");
+		return std::max<std::size_t>(2, std::bit_ceil(capacity));
+	}
+
+	static std::ptrdiff_t distance(std::size_t sequence, std::size_t pos) noexcept
+	{
+		return static_cast<std::ptrdiff_t>(sequence - pos);
+	}
+
+	// Занимает ячейку для записи; nullptr — очередь заполнена.
+	Slot *claim_for_push(std::size_t &pos) noexcept
+	{
+		pos = enqueue_pos_.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Slot &slot = slots_[pos & mask_];
+			const std::ptrdiff_t diff = distance(slot.sequence.load(std::memory_order_acquire), pos);
+			if (diff == 0)
+			{
+				if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					return &slot;
+			}
+			else if (diff < 0)
+			{
+				return nullptr;
+			}
+			else
+			{
+				pos = enqueue_pos_.load(std::memory_order_relaxed);
+			}
+		}
+	}
 
 public:
-	using iterator_category = std::forward_iterator_tag;
 	using value_type = T;
-	using difference_type = std::ptrdiff_t;
-	using pointer = T *;
-	using reference = T &;
 
-	explicit QueueIterator(QueueNode<T> *node = nullptr) : node_(node) {}
+	explicit pmr_bounded_mpmc_queue(std::size_t capacity, std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+		: slots_(nullptr), mask_(round_capacity(capacity) - 1), alloc_(mr)
+	{
+		slots_ = alloc_.template allocate_object<Slot>(mask_ + 1);
+		for (std::size_t i = 0; i <= mask_; ++i)
+		{
+			Slot *slot = ::new (static_cast<void *>(slots_ + i)) Slot;
+			slot->sequence.store(i, std::memory_order_relaxed);
+		}
+	}
 
-	T &operator*() const { return node_->value; }
-	T *operator->() const { return &(node_->value); }
+	~pmr_bounded_mpmc_queue()
+	{
+		const std::size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+		for (std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed); pos != end; ++pos)
+			std::allocator_traits<Alloc>::destroy(alloc_, slots_[pos & mask_].value());
+		std::destroy_n(slots_, mask_ + 1);
+		alloc_.deallocate_object(slots_, mask_ + 1);
+	}
 
-	QueueIterator &operator++()
+	// false — очередь заполнена. Если конструирование T может бросить, значение
+	// собирается до захвата ячейки, чтобы исключение не оставило её занятой.
+	// Для типов с аллокатором вызывается конструктор с аллокатором, который
+	// может выделять память даже при перемещении, поэтому они собираются заранее всегда.
+	template <typename... Args>
+	bool try_emplace(Args &&...args)
 	{
-		if (node_)
-			node_ = node_->next;
-		return *this;
+		std::size_t pos = 0;
+		if constexpr (!std::uses_allocator_v<T, Alloc> && std::is_nothrow_constructible_v<T, Args...>)
+		{
+			Slot *slot = claim_for_push(pos);
+			if (slot == nullptr)
+				return false;
+			std::allocator_traits<Alloc>::construct(alloc_, slot->value(), std::forward<Args>(args)...);
+			slot->sequence.store(pos + 1, std::memory_order_release);
+		}
+		else
+		{
+			T value = std::make_obj_using_allocator<T>(alloc_, std::forward<Args>(args)...);
+			Slot *slot = claim_for_push(pos);
+			if (slot == nullptr)
+				return false;
+			std::construct_at(slot->value(), std::move(value));
+			slot->sequence.store(pos + 1, std::memory_order_release);
+		}
+		return true;
 	}
 
-	QueueIterator operator++(int)
+	bool try_push(const T &value)
 	{
-		QueueIterator tmp = *this;
-		++(*this);
-		return tmp;
+		return try_emplace(value);
 	}
 
-	bool operator==(const QueueIterator &other) const
+	bool try_push(T &&value)
 	{
-		return node_ == other.node_;
+		return try_emplace(std::move(value));
 	}
 
-	bool operator!=(const QueueIterator &other) const
+	// false — очередь пуста. Если присваивание бросит, элемент теряется, но ячейка освобождается.
+	bool try_pop(T &out) noexcept(std::is_nothrow_move_assignable_v<T>)
 	{
-		return !(*this == other);
+		std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+		Slot *slot = nullptr;
+		for (;;)
+		{
+			slot = slots_ + (pos & mask_);
+			const std::ptrdiff_t diff = distance(slot->sequence.load(std::memory_order_acquire), pos + 1);
+			if (diff == 0)
+			{
+				if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = dequeue_pos_.load(std::memory_order_relaxed);
+			}
+		}
+
+		struct Release
+		{
+			pmr_bounded_mpmc_queue *queue;
+			Slot *slot;
+			std::size_t next_sequence;
+
+			~Release()
+			{
+				std::allocator_traits<Alloc>::destroy(queue->alloc_, slot->value());
+				slot->sequence.store(next_sequence, std::memory_order_release);
+			}
+		} release{this, slot, pos + mask_ + 1};
+		out = std::move(*slot->value());
+		return true;
+	}
+
+	// Приблизительные значения при конкурентном доступе.
+	std::size_t size() const noexcept
+	{
+		const std::size_t head = dequeue_pos_.load(std::memory_order_acquire);
+		const std::size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+		return tail > head ? tail - head : 0;
 	}
+
+	bool empty() const noexcept
+	{
+		return size() == 0;
+	}
+
+	std::size_t capacity() const noexcept
+	{
+		return mask_ + 1;
+	}
+
+	pmr_bounded_mpmc_queue(const pmr_bounded_mpmc_queue &) = delete;
+	pmr_bounded_mpmc_queue &operator=(const pmr_bounded_mpmc_queue &) = delete;
 };
 
+// Блокирующая обёртка над pmr_queue. Потребители будятся, только когда в очереди
+// набирается wake_threshold элементов либо когда истекает max_latency с момента
+// появления первого элемента, поэтому при высоком темпе сообщений число
+// пробуждений падает примерно в wake_threshold раз. Ресурс используется только
+// под внутренним мьютексом и не обязан быть потокобезопасным.
 template <typename T>
-class pmr_queue
+class pmr_blocking_queue
 {
 private:
-	using Node = QueueNode<T>;
-	using Alloc = std::pmr::polymorphic_allocator<T>;
-	using NodeAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Node>;
+	using clock = std::chrono::steady_clock;
 
-	Node *head_ = nullptr;
-	Node *tail_ = nullptr;
-	std::size_t size_ = 0;
-	mutable Alloc alloc_;
+	mutable std::mutex mutex_;
+	std::condition_variable_any ready_;
+	pmr_queue<T> queue_;
+	std::size_t wake_threshold_;
+	clock::duration max_latency_;
+	std::size_t waiters_ = 0;
+	std::size_t flush_epoch_ = 0;
+	// Момент, когда пустая очередь получила элемент; от него отсчитывается max_latency.
+	clock::time_point first_pending_{};
+
+	template <typename Predicate>
+	bool wait_until(std::unique_lock<std::mutex> &lock, std::stop_token &stop, clock::time_point deadline,
+					Predicate predicate)
+	{
+		if (deadline == clock::time_point::max())
+			return ready_.wait(lock, stop, predicate);
+		return ready_.wait_until(lock, stop, deadline, predicate);
+	}
+
+	// Ждёт первого элемента, затем — порога, flush() или истечения max_latency
+	// с момента его появления; опоздавшие элементы отдаются сразу.
+	// Если за это время элементы забрал другой потребитель, ожидание начинается
+	// заново. Возвращает true, если в очереди есть что забрать; false — только
+	// при запросе остановки или по истечении deadline.
+	bool wait_ready(std::unique_lock<std::mutex> &lock, std::stop_token &stop, clock::time_point deadline)
+	{
+		++waiters_;
+		bool ready = false;
+		while (wait_until(lock, stop, deadline, [this]
+						  { return !queue_.empty(); }))
+		{
+			const std::size_t epoch = flush_epoch_;
+			const clock::time_point flush_at = std::min(deadline, first_pending_ + max_latency_);
+			wait_until(lock, stop, flush_at, [this, epoch]
+					   { return queue_.size() >= wake_threshold_ || flush_epoch_ != epoch; });
+			ready = !queue_.empty();
+			if (ready)
+				break;
+		}
+		--waiters_;
+		return ready;
+	}
+
+	std::optional<T> pop_ready(std::stop_token &stop, clock::time_point deadline)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!wait_ready(lock, stop, deadline))
+			return std::nullopt;
+		return queue_.pop_front_value();
+	}
 
 public:
 	using value_type = T;
-	using iterator = QueueIterator<T>;
 
-	explicit pmr_queue(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
-		: alloc_(mr) {}
+	explicit pmr_blocking_queue(std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+		: pmr_blocking_queue(1, std::chrono::milliseconds(1), mr)
+	{
+	}
 
-	~pmr_queue()
+	pmr_blocking_queue(std::size_t wake_threshold, clock::duration max_latency,
+					   std::pmr::memory_resource *mr = std::pmr::get_default_resource())
+		: queue_(mr), wake_threshold_(std::max<std::size_t>(1, wake_threshold)), max_latency_(max_latency)
 	{
-		while (head_ != nullptr)
+	}
+
+	template <typename... Args>
+	void emplace(Args &&...args)
+	{
+		bool wake = false;
 		{
-			Node *tmp = head_;
-			head_ = head_->next;
-			NodeAlloc na(alloc_);
-			std::allocator_traits<NodeAlloc>::destroy(na, tmp);
-			std::allocator_traits<NodeAlloc>::deallocate(na, tmp, 1);
+			std::lock_guard<std::mutex> lock(mutex_);
+			queue_.emplace(std::forward<Args>(args)...);
+			const std::size_t size = queue_.size();
+			if (size == 1)
+				first_pending_ = clock::now();
+			wake = waiters_ != 0 && (size == 1 || size % wake_threshold_ == 0);
 		}
+		if (wake)
+			ready_.notify_one();
 	}
 
 	void push(const T &value)
 	{
-		NodeAlloc na(alloc_);
-		Node *newNode = std::allocator_traits<NodeAlloc>::allocate(na, 1);
-		std::allocator_traits<NodeAlloc>::construct(na, newNode, alloc_, value);
-		if (tail_ == nullptr)
-		{
-			head_ = tail_ = newNode;
-		}
-		else
-		{
-			tail_->next = newNode;
-			tail_ = newNode;
-		}
-		++size_;
+		emplace(value);
 	}
 
 	void push(T &&value)
 	{
-		NodeAlloc na(alloc_);
-		Node *newNode = std::allocator_traits<NodeAlloc>::allocate(na, 1);
-		std::allocator_traits<NodeAlloc>::construct(na, newNode, alloc_, std::move(value));
-		if (tail_ == nullptr)
-		{
-			head_ = tail_ = newNode;
-		}
-		else
+		emplace(std::move(value));
+	}
+
+	// Будит всех ожидающих, не дожидаясь порога: накопленное отдаётся сразу.
+	void flush()
+	{
 		{
-			tail_->next = newNode;
-			tail_ = newNode;
+			std::lock_guard<std::mutex> lock(mutex_);
+			++flush_epoch_;
 		}
-		++size_;
+		ready_.notify_all();
 	}
 
-	void pop()
+	// nullopt — запрошена остановка, а очередь пуста.
+	std::optional<T> pop_wait(std::stop_token stop = {})
 	{
-		if (head_ == nullptr)
-			throw std::runtime_error("pop from empty queue");
-		Node *tmp = head_;
-		head_ = head_->next;
-		if (head_ == nullptr)
-			tail_ = nullptr;
-		NodeAlloc na(alloc_);
-		std::allocator_traits<NodeAlloc>::destroy(na, tmp);
-		std::allocator_traits<NodeAlloc>::deallocate(na, tmp, 1);
-		--size_;
+		return pop_ready(stop, clock::time_point::max());
 	}
 
-	T &front()
+	// nullopt — за timeout ничего не пришло или запрошена остановка.
+	template <typename Rep, typename Period>
+	std::optional<T> pop_wait_for(const std::chrono::duration<Rep, Period> &timeout, std::stop_token stop = {})
 	{
-		if (head_ == nullptr)
-			throw std::runtime_error("front of empty queue");
-		return head_->value;
+		return pop_ready(stop, clock::now() + std::chrono::ceil<clock::duration>(timeout));
 	}
 
-	const T &front() const
+	// Перемещает в out до max_n элементов за одно пробуждение.
+	template <typename OutputIt>
+	OutputIt pop_batch_wait(OutputIt out, std::size_t max_n, std::stop_token stop = {})
 	{
-		if (head_ == nullptr)
-			throw std::runtime_error("front of empty queue");
-		return head_->value;
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (max_n == 0 || !wait_ready(lock, stop, clock::time_point::max()))
+			return out;
+		return queue_.drain_into(out, max_n);
 	}
 
-	bool empty() const noexcept
+	bool try_pop(T &out)
 	{
-		return head_ == nullptr;
+		std::lock_guard<std::mutex> lock(mutex_);
+		return queue_.try_pop(out);
 	}
 
-	std::size_t size() const noexcept
+	std::size_t size() const
 	{
-		return size_;
+		std::lock_guard<std::mutex> lock(mutex_);
+		return queue_.size();
 	}
 
-	iterator begin() const { return iterator(head_); }
-	iterator end() const { return iterator(nullptr); }
+	bool empty() const
+	{
+		return size() == 0;
+	}
 
-	pmr_queue(const pmr_queue &) = delete;
-	pmr_queue &operator=(const pmr_queue &) = delete;
-	pmr_queue(pmr_queue &&) = delete;
-	pmr_queue &operator=(pmr_queue &&) = delete;
+	std::size_t wake_threshold() const noexcept
+	{
+		return wake_threshold_;
+	}
+
+	pmr_blocking_queue(const pmr_blocking_queue &) = delete;
+	pmr_blocking_queue &operator=(const pmr_blocking_queue &) = delete;
 };
 
 #endif
\ No newline at end of file
@@ -41,5 +41,16 @@ int main()
 	}
 	std::cout << "\n";
 
+	pmr_ring_queue<Point> point_ring(&mr);
+	point_ring.push(Point{7, 8});
+	point_ring.push(Point{9, 10});
+
+	std::cout << "point ring queue: ";
+	for (const auto &p : point_ring)
+	{
+		std::cout << p << " ";
+	}
+	std::cout << "\n";
+
 	return 0;
 }
\ No newline at end of file
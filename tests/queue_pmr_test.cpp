@@ -1,7 +1,15 @@
 #include <gtest/gtest.h>
 #include <memory_resource>
 #include <vector>
+#include <array>
 #include <type_traits>
+#include <algorithm>
+#include <string>
+#include <ranges>
+#include <iterator>
+#include <optional>
+#include <thread>
+#include <future>
 #include "queue_pmr.hpp"
 
 // Тест: memory_resource наследует std::pmr::memory_resource
@@ -40,6 +48,410 @@ TEST(MemoryResourceTest, CleansUpOnDestruction)
 	}
 	SUCCEED();
 }
+// Тест: освобождение большого числа блоков в произвольном порядке
+TEST(MemoryResourceTest, DeallocateManyBlocksOutOfOrder)
+{
+	DynamicVectorMemoryResource mr;
+	std::vector<void *> ptrs;
+	for (int i = 0; i < 1000; ++i)
+	{
+		ptrs.push_back(mr.allocate(32, 8));
+	}
+	for (std::size_t i = 0; i < ptrs.size(); i += 2)
+	{
+		mr.deallocate(ptrs[i], 32, 8);
+	}
+	for (std::size_t i = 1; i < ptrs.size(); i += 2)
+	{
+		mr.deallocate(ptrs[i], 32, 8);
+	}
+
+	// Адреса освобождённых блоков могут вернуться повторно
+	for (int i = 0; i < 1000; ++i)
+	{
+		ptrs[i] = mr.allocate(32, 8);
+		ASSERT_NE(ptrs[i], nullptr);
+	}
+	for (void *p : ptrs)
+	{
+		mr.deallocate(p, 32, 8);
+	}
+}
+
+// Тест: освобождённый блок возвращается при следующем запросе того же размера
+TEST(MemoryResourceTest, ReusesFreedBlockOfSameSize)
+{
+	DynamicVectorMemoryResource mr;
+
+	void *p1 = mr.allocate(24, alignof(std::max_align_t));
+	mr.deallocate(p1, 24, alignof(std::max_align_t));
+	void *p2 = mr.allocate(20, alignof(std::max_align_t));
+	EXPECT_EQ(p1, p2);
+
+	// Блок с большим выравниванием не подменяется блоком из другого класса
+	void *p3 = mr.allocate(24, 64);
+	EXPECT_NE(p3, p2);
+	EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p3) % 64, 0u);
+
+	mr.deallocate(p2, 20, alignof(std::max_align_t));
+	mr.deallocate(p3, 24, 64);
+}
+
+// Тест: повторное использование работает для множества классов размера и выравнивания
+TEST(MemoryResourceTest, ReusesBlocksAcrossManySizeClasses)
+{
+	DynamicVectorMemoryResource mr;
+	for (std::size_t i = 1; i <= 3000; ++i)
+	{
+		const std::size_t alignment = i % 3 == 0 ? 64 : 8;
+		mr.deallocate(mr.allocate(i * 16, alignment), i * 16, alignment);
+	}
+	for (std::size_t size : {16u, 48u, 1024u, 1040u, 30000u, 48000u})
+	{
+		for (std::size_t alignment : {8u, 64u})
+		{
+			void *p1 = mr.allocate(size, alignment);
+			EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p1) % alignment, 0u);
+			mr.deallocate(p1, size, alignment);
+			void *p2 = mr.allocate(size, alignment);
+			EXPECT_EQ(p1, p2);
+			mr.deallocate(p2, size, alignment);
+		}
+	}
+}
+
+// Тест: метаданные ресурса не растут вместе с историей выделений
+TEST(MemoryResourceTest, MetadataStaysProportionalToLiveBlocks)
+{
+	DynamicVectorMemoryResource mr;
+	std::vector<void *> ptrs;
+	for (int i = 0; i < 10000; ++i)
+	{
+		ptrs.push_back(mr.allocate(64, 8));
+	}
+	const std::size_t peak = mr.metadata_bytes();
+	for (void *p : ptrs)
+	{
+		mr.deallocate(p, 64, 8);
+	}
+	EXPECT_LT(mr.metadata_bytes(), peak / 10);
+
+	// Длинная серия push/pop при небольшом числе живых узлов
+	pmr_queue<int> q(&mr);
+	for (int i = 0; i < 100000; ++i)
+	{
+		q.push(i);
+		if (q.size() > 8)
+		{
+			q.pop();
+		}
+	}
+	EXPECT_LT(mr.metadata_bytes(), peak / 10);
+}
+
+// Тест: классы размера, от которых не осталось блоков, не копятся в метаданных
+TEST(MemoryResourceTest, MetadataDropsUnusedSizeClasses)
+{
+	DynamicVectorMemoryResource mr;
+	for (std::size_t i = 1; i <= 20000; ++i)
+	{
+		mr.deallocate(mr.allocate(i * 16, 8), i * 16, 8);
+	}
+	EXPECT_LT(mr.metadata_bytes(), 32u * 1024);
+
+	void *p = mr.allocate(20000 * 16, 8);
+	ASSERT_NE(p, nullptr);
+	mr.deallocate(p, 20000 * 16, 8);
+}
+
+// Тест: в режиме чанков соседние блоки нарезаются подряд
+TEST(MemoryResourceTest, SlabModeCarvesAdjacentBlocks)
+{
+	DynamicVectorMemoryResource mr(DynamicVectorResourceOptions{64 * 1024});
+
+	auto *p1 = static_cast<std::byte *>(mr.allocate(16, 8));
+	auto *p2 = static_cast<std::byte *>(mr.allocate(16, 8));
+	EXPECT_EQ(p2, p1 + 16);
+
+	mr.deallocate(p1, 16, 8);
+	EXPECT_EQ(mr.allocate(16, 8), p1);
+
+	// Повторное освобождение блока из чанка игнорируется
+	mr.deallocate(p2, 16, 8);
+	mr.deallocate(p2, 16, 8);
+	void *p3 = mr.allocate(16, 8);
+	void *p4 = mr.allocate(16, 8);
+	EXPECT_EQ(p3, p2);
+	EXPECT_NE(p4, p2);
+	mr.deallocate(p3, 16, 8);
+	mr.deallocate(p4, 16, 8);
+
+	// Крупный блок выделяется напрямую, мимо чанков
+	void *big = mr.allocate(32 * 1024, 8);
+	ASSERT_NE(big, nullptr);
+	mr.deallocate(big, 32 * 1024, 8);
+
+	// Очередь поверх ресурса с чанками
+	pmr_queue<int> q(&mr);
+	for (int i = 0; i < 10000; ++i)
+	{
+		q.push(i);
+	}
+	int expected = 0;
+	for (int v : q)
+	{
+		EXPECT_EQ(v, expected++);
+	}
+}
+
+// Ресурс-счётчик для проверки обращений к вышестоящему ресурсу
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	std::size_t allocations = 0;
+	std::size_t deallocations = 0;
+	std::size_t outstanding_bytes = 0;
+
+protected:
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		++allocations;
+		outstanding_bytes += bytes;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+	{
+		++deallocations;
+		outstanding_bytes -= bytes;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+// Тест: блоки и метаданные берутся из переданного вышестоящего ресурса
+TEST(MemoryResourceTest, UsesUpstreamResource)
+{
+	CountingResource upstream;
+	{
+		DynamicVectorMemoryResource mr(&upstream);
+		EXPECT_EQ(mr.upstream_resource(), &upstream);
+
+		pmr_queue<int> q(&mr);
+		for (int i = 0; i < 1000; ++i)
+		{
+			q.push(i);
+		}
+		// Узлы плюс таблица блоков и хеш-индекс
+		EXPECT_GT(upstream.allocations, 1000u);
+	}
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+	EXPECT_EQ(upstream.allocations, upstream.deallocations);
+
+	// Вся память ресурса может лежать в заранее выделенном буфере
+	std::vector<std::byte> buffer(1 << 20);
+	std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+	DynamicVectorMemoryResource mr(DynamicVectorResourceOptions{64 * 1024}, &arena);
+	pmr_queue<int> q(&mr);
+	for (int i = 0; i < 10000; ++i)
+	{
+		q.push(i);
+	}
+	EXPECT_EQ(q.size(), 10000u);
+}
+
+// Ресурс, который по флагу перестаёт выделять память
+class FailingResource : public std::pmr::memory_resource
+{
+public:
+	bool fail = false;
+
+protected:
+	void *do_allocate(std::size_t bytes, std::size_t alignment) override
+	{
+		if (fail)
+			throw std::bad_alloc();
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override
+	{
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+// Тест: освобождение не обращается к исчерпанному вышестоящему ресурсу
+template <typename Resource>
+void check_deallocate_without_upstream()
+{
+	FailingResource upstream;
+	Resource mr(&upstream);
+	std::vector<void *> blocks;
+	for (std::size_t i = 0; i < 8; ++i)
+	{
+		blocks.push_back(mr.allocate(2048 + i * 16, 16));
+	}
+	upstream.fail = true;
+	for (std::size_t i = 0; i < blocks.size(); ++i)
+	{
+		mr.deallocate(blocks[i], 2048 + i * 16, 16);
+	}
+	EXPECT_THROW(static_cast<void>(mr.allocate(100000, 16)), std::bad_alloc);
+	upstream.fail = false;
+	void *p = mr.allocate(2048, 16);
+	EXPECT_EQ(p, blocks[0]);
+	mr.deallocate(p, 2048, 16);
+}
+
+TEST(MemoryResourceTest, DeallocateNeverAllocates)
+{
+	check_deallocate_without_upstream<DynamicVectorMemoryResource>();
+	check_deallocate_without_upstream<IntrusiveDynamicVectorMemoryResource>();
+}
+
+// Тест: режим с заголовками блоков вместо внешней таблицы
+TEST(MemoryResourceTest, IntrusiveHeaderPolicy)
+{
+	static_assert(std::is_base_of_v<std::pmr::memory_resource, IntrusiveDynamicVectorMemoryResource>);
+
+	CountingResource upstream;
+	{
+		IntrusiveDynamicVectorMemoryResource mr(&upstream);
+
+		void *p1 = mr.allocate(24, 8);
+		mr.deallocate(p1, 24, 8);
+		mr.deallocate(p1, 24, 8); // повторное освобождение игнорируется
+		void *p2 = mr.allocate(24, 8);
+		EXPECT_EQ(p1, p2);
+
+		void *aligned = mr.allocate(100, 256);
+		EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % 256, 0u);
+		mr.deallocate(aligned, 100, 256);
+
+		pmr_queue<std::string> q(&mr);
+		for (int i = 0; i < 1000; ++i)
+		{
+			q.push(std::to_string(i));
+		}
+		for (int i = 0; i < 500; ++i)
+		{
+			EXPECT_EQ(q.front(), std::to_string(i));
+			q.pop();
+		}
+		EXPECT_GT(mr.metadata_bytes(), 0u);
+	}
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+
+	IntrusiveDynamicVectorMemoryResource slab(DynamicVectorResourceOptions{64 * 1024});
+	pmr_queue<int> q(&slab);
+	for (int i = 0; i < 10000; ++i)
+	{
+		q.push(i);
+	}
+	int expected = 0;
+	while (!q.empty())
+	{
+		EXPECT_EQ(q.front(), expected++);
+		q.pop();
+	}
+	EXPECT_EQ(expected, 10000);
+}
+
+// Тест: release() возвращает всю память, ресурс остаётся пригодным
+TEST(MemoryResourceTest, ReleaseReturnsEverythingToUpstream)
+{
+	CountingResource upstream;
+	DynamicVectorMemoryResource mr(DynamicVectorResourceOptions{64 * 1024}, &upstream);
+	static_cast<void>(mr.allocate(16, 8));
+	static_cast<void>(mr.allocate(100000, 8));
+	mr.release();
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+
+	void *p = mr.allocate(16, 8);
+	ASSERT_NE(p, nullptr);
+	mr.deallocate(p, 16, 8);
+}
+
+// Тест: после reset() прогретый ресурс не обращается к вышестоящему
+template <typename Resource>
+void check_reset_keeps_memory()
+{
+	CountingResource upstream;
+	Resource mr(DynamicVectorResourceOptions{4 * 1024}, &upstream);
+	auto run_request = [&mr]
+	{
+		pmr_queue<int> q(&mr);
+		for (int i = 0; i < 2000; ++i)
+		{
+			q.push(i);
+		}
+		static_cast<void>(mr.allocate(4096, 8));
+	};
+
+	run_request();
+	mr.reset();
+	const std::size_t warm = upstream.allocations;
+	for (int request = 0; request < 5; ++request)
+	{
+		run_request();
+		mr.reset();
+	}
+	EXPECT_EQ(upstream.allocations, warm);
+}
+
+TEST(MemoryResourceTest, ResetKeepsObtainedMemory)
+{
+	check_reset_keeps_memory<DynamicVectorMemoryResource>();
+	check_reset_keeps_memory<IntrusiveDynamicVectorMemoryResource>();
+}
+
+// Тест: счётчики статистики ресурса
+TEST(MemoryResourceTest, CollectsAllocationStats)
+{
+	static_assert(sizeof(DynamicVectorMemoryResource) <
+					  sizeof(BasicDynamicVectorMemoryResource<SideTableTracking, CollectAllocationStats>),
+				  "statistics must not cost anything when disabled");
+
+	BasicDynamicVectorMemoryResource<SideTableTracking, CollectAllocationStats> mr;
+	void *p1 = mr.allocate(16, 8);
+	void *p2 = mr.allocate(100, 8);
+	mr.deallocate(p1, 16, 8);
+
+	int foreign = 0;
+	mr.deallocate(&foreign, sizeof(foreign), alignof(int));
+	mr.deallocate(p1, 16, 8);
+
+	const AllocationStats &stats = mr.stats();
+	EXPECT_EQ(stats.allocations, 2u);
+	EXPECT_EQ(stats.deallocations, 1u);
+	EXPECT_EQ(stats.unknown_deallocations, 2u);
+	EXPECT_EQ(stats.live_bytes, 100u);
+	EXPECT_EQ(stats.peak_bytes, 116u);
+	EXPECT_EQ(stats.size_class_histogram[0], 1u);
+	EXPECT_EQ(stats.size_class_histogram[3], 1u);
+	EXPECT_GE(stats.average_probe_length(), 1.0);
+
+	mr.deallocate(p2, 100, 8);
+	EXPECT_EQ(mr.stats().live_bytes, 0u);
+
+	// Повторное освобождение блока из чанка тоже считается неизвестным
+	BasicDynamicVectorMemoryResource<SideTableTracking, CollectAllocationStats> slab(DynamicVectorResourceOptions{4096});
+	void *p3 = slab.allocate(16, 8);
+	slab.deallocate(p3, 16, 8);
+	slab.deallocate(p3, 16, 8);
+	EXPECT_EQ(slab.stats().deallocations, 1u);
+	EXPECT_EQ(slab.stats().unknown_deallocations, 1u);
+}
+
 // Тест: очередь использует polymorphic_allocator
 TEST(QueueTest, UsesPolymorphicAllocator)
 {
@@ -169,4 +581,1128 @@ TEST(QueueTest, QueueDestructorReleasesMemory)
 		// Ничего не удаляем вручную — деструктор очереди должен вызвать deallocate
 	} // ← здесь всё освобождается
 	SUCCEED(); // Если не упало — ок
-}
\ No newline at end of file
+}
+
+// Тест: clear() и discard() опустошают очередь
+TEST(QueueTest, ClearAndDiscard)
+{
+	CountingResource upstream;
+	DynamicVectorMemoryResource mr(DynamicVectorResourceOptions{64 * 1024}, &upstream);
+	pmr_queue<std::string> q(&mr);
+	for (int i = 0; i < 100; ++i)
+	{
+		q.push(std::string(100, 'x'));
+	}
+	q.clear();
+	EXPECT_TRUE(q.empty());
+	EXPECT_EQ(q.size(), 0u);
+	EXPECT_EQ(q.begin(), q.end());
+
+	q.push("after clear");
+	EXPECT_EQ(q.front(), "after clear");
+
+	pmr_queue<int> ints(&mr);
+	for (int i = 0; i < 1000; ++i)
+	{
+		ints.push(i);
+	}
+	ints.discard();
+	EXPECT_TRUE(ints.empty());
+	q.discard();
+	mr.release();
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+}
+
+// Тест: сегментированная очередь сохраняет порядок и выделяет память сегментами
+TEST(SegmentedQueueTest, KeepsFifoOrderAcrossSegments)
+{
+	CountingResource upstream;
+	{
+		pmr_segmented_queue<int, 64> q(&upstream);
+		EXPECT_TRUE(q.empty());
+		EXPECT_EQ(q.begin(), q.end());
+		EXPECT_THROW(q.pop(), std::runtime_error);
+
+		for (int i = 0; i < 1000; ++i)
+		{
+			q.push(i);
+		}
+		EXPECT_EQ(q.size(), 1000u);
+		EXPECT_EQ(upstream.allocations, 16u);
+
+		int expected = 0;
+		for (int v : q)
+		{
+			EXPECT_EQ(v, expected++);
+		}
+		EXPECT_EQ(expected, 1000);
+
+		for (int i = 0; i < 1000; ++i)
+		{
+			EXPECT_EQ(q.front(), i);
+			q.pop();
+			q.push(1000 + i);
+		}
+		EXPECT_EQ(q.front(), 1000);
+	}
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+}
+
+TEST(SegmentedQueueTest, WorksForComplexType)
+{
+	DynamicVectorMemoryResource mr;
+	pmr_segmented_queue<ComplexData, 3> q(&mr);
+	for (int i = 0; i < 10; ++i)
+	{
+		q.push(ComplexData{i, i * 0.5, std::to_string(i)});
+	}
+	for (int i = 0; i < 10; ++i)
+	{
+		EXPECT_EQ(q.front(), (ComplexData{i, i * 0.5, std::to_string(i)}));
+		q.pop();
+	}
+	EXPECT_TRUE(q.empty());
+	q.push(ComplexData{42});
+	EXPECT_EQ(q.front().id, 42);
+}
+
+// Тест: кольцевая очередь растёт и сохраняет порядок при переходе через край буфера
+TEST(RingQueueTest, GrowsAndWrapsAround)
+{
+	DynamicVectorMemoryResource mr;
+	pmr_ring_queue<int> q(&mr);
+	EXPECT_TRUE(q.empty());
+	EXPECT_EQ(q.begin(), q.end());
+	EXPECT_THROW(q.front(), std::runtime_error);
+
+	for (int i = 0; i < 6; ++i)
+	{
+		q.push(i);
+	}
+	q.pop();
+	q.pop();
+	for (int i = 6; i < 20; ++i)
+	{
+		q.push(i);
+	}
+	EXPECT_EQ(q.size(), 18u);
+	EXPECT_EQ(q.capacity(), 32u);
+
+	std::vector<int> actual(q.begin(), q.end());
+	std::vector<int> expected;
+	for (int i = 2; i < 20; ++i)
+	{
+		expected.push_back(i);
+	}
+	EXPECT_EQ(actual, expected);
+}
+
+// Тест: в установившемся режиме push/pop не выделяют память
+TEST(RingQueueTest, SteadyStateDoesNotAllocate)
+{
+	CountingResource upstream;
+	{
+		pmr_ring_queue<ComplexData> q(&upstream);
+		q.reserve(16);
+		const std::size_t allocations = upstream.allocations;
+		for (int i = 0; i < 1000; ++i)
+		{
+			q.push(ComplexData{i, 1.0, "x"});
+			if (q.size() > 10)
+			{
+				q.pop();
+			}
+		}
+		EXPECT_EQ(upstream.allocations, allocations);
+		EXPECT_EQ(q.front().id, 990);
+	}
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+}
+
+// Тип, считающий копирования и перемещения
+struct MoveCounter
+{
+	static inline int copies = 0;
+	static inline int moves = 0;
+
+	int id;
+	std::string name;
+
+	MoveCounter(int id, std::string name) : id(id), name(std::move(name)) {}
+	MoveCounter(const MoveCounter &other) : id(other.id), name(other.name) { ++copies; }
+	MoveCounter(MoveCounter &&other) noexcept : id(other.id), name(std::move(other.name)) { ++moves; }
+};
+
+// Тест: emplace конструирует элемент на месте во всех очередях
+template <typename Queue>
+void check_emplace_constructs_in_place()
+{
+	DynamicVectorMemoryResource mr;
+	Queue q(&mr);
+	MoveCounter::copies = MoveCounter::moves = 0;
+
+	MoveCounter &ref = q.emplace(1, "first");
+	EXPECT_EQ(ref.id, 1);
+	q.emplace(2, "second");
+	EXPECT_EQ(MoveCounter::copies, 0);
+	EXPECT_EQ(MoveCounter::moves, 0);
+	EXPECT_EQ(q.front().name, "first");
+	EXPECT_EQ(q.size(), 2u);
+}
+
+TEST(QueueTest, EmplaceConstructsInPlace)
+{
+	check_emplace_constructs_in_place<pmr_queue<MoveCounter>>();
+	check_emplace_constructs_in_place<pmr_segmented_queue<MoveCounter>>();
+	check_emplace_constructs_in_place<pmr_ring_queue<MoveCounter>>();
+}
+
+// Тест: вставка ссылки на собственный элемент при росте кольцевого буфера
+TEST(RingQueueTest, PushOwnElementWhileGrowing)
+{
+	DynamicVectorMemoryResource mr;
+	pmr_ring_queue<std::string> q(&mr);
+	q.push(std::string(50, 'a'));
+	while (q.size() < q.capacity())
+	{
+		q.push("filler");
+	}
+	q.push(q.front());
+	EXPECT_EQ(std::count(q.begin(), q.end(), std::string(50, 'a')), 2);
+}
+
+// Тест: вложенные pmr-контейнеры получают ресурс очереди
+template <template <typename> class Queue>
+void check_uses_allocator_construction()
+{
+	DynamicVectorMemoryResource mr;
+	std::pmr::string outside(100, 'x', std::pmr::new_delete_resource());
+
+	Queue<std::pmr::string> strings(&mr);
+	strings.push(outside);
+	strings.push(std::pmr::string(100, 'y'));
+	strings.emplace(100, 'z');
+	for (const auto &s : strings)
+	{
+		EXPECT_EQ(s.get_allocator().resource(), &mr);
+	}
+
+	Queue<std::pmr::vector<int>> vectors(&mr);
+	vectors.emplace(10, 1);
+	EXPECT_EQ(vectors.front().get_allocator().resource(), &mr);
+}
+
+template <typename T>
+using segmented_queue_for_test = pmr_segmented_queue<T>;
+
+TEST(QueueTest, PropagatesAllocatorToElements)
+{
+	check_uses_allocator_construction<pmr_queue>();
+	check_uses_allocator_construction<segmented_queue_for_test>();
+	check_uses_allocator_construction<pmr_ring_queue>();
+}
+
+// Тест: перемещение очереди на том же ресурсе забирает узлы без копирования
+TEST(QueueTest, MoveStealsNodesOnEqualResource)
+{
+	DynamicVectorMemoryResource mr;
+	pmr_queue<int> source(&mr);
+	for (int i = 0; i < 5; ++i)
+	{
+		source.push(i);
+	}
+	const int *first = &source.front();
+
+	pmr_queue<int> moved(std::move(source));
+	EXPECT_TRUE(source.empty());
+	EXPECT_EQ(moved.size(), 5u);
+	EXPECT_EQ(&moved.front(), first);
+	EXPECT_EQ(moved.get_allocator().resource(), &mr);
+
+	pmr_queue<int> assigned(&mr);
+	assigned.push(100);
+	assigned = std::move(moved);
+	EXPECT_TRUE(moved.empty());
+	EXPECT_EQ(&assigned.front(), first);
+	EXPECT_EQ(assigned.size(), 5u);
+
+	// Источник после перемещения пригоден для работы
+	moved.push(7);
+	EXPECT_EQ(moved.front(), 7);
+}
+
+// Тест: перемещение между разными ресурсами переносит элементы по одному
+TEST(QueueTest, MoveAcrossResourcesMovesElements)
+{
+	DynamicVectorMemoryResource mr1;
+	CountingResource upstream;
+	DynamicVectorMemoryResource mr2(&upstream);
+
+	pmr_queue<std::pmr::string> source(&mr1);
+	source.push("alpha");
+	source.push("beta");
+
+	pmr_queue<std::pmr::string> target(std::move(source), &mr2);
+	EXPECT_TRUE(source.empty());
+	EXPECT_EQ(target.get_allocator().resource(), &mr2);
+	EXPECT_GT(upstream.allocations, 0u);
+	std::vector<std::pmr::string> actual(target.begin(), target.end());
+	EXPECT_EQ(actual, (std::vector<std::pmr::string>{"alpha", "beta"}));
+
+	pmr_queue<std::pmr::string> other(&mr1);
+	other.push("gamma");
+	target = std::move(other);
+	EXPECT_EQ(target.size(), 1u);
+	EXPECT_EQ(target.front(), "gamma");
+	EXPECT_EQ(target.front().get_allocator().resource(), &mr2);
+}
+
+// Тест: обмен очередей на одном и на разных ресурсах
+TEST(QueueTest, Swap)
+{
+	DynamicVectorMemoryResource mr1;
+	DynamicVectorMemoryResource mr2;
+	pmr_queue<int> a(&mr1);
+	pmr_queue<int> b(&mr1);
+	pmr_queue<int> c(&mr2);
+	a.push(1);
+	b.push(2);
+	b.push(3);
+	c.push(4);
+
+	swap(a, b);
+	EXPECT_EQ(a.size(), 2u);
+	EXPECT_EQ(a.front(), 2);
+	EXPECT_EQ(b.front(), 1);
+
+	a.swap(c);
+	EXPECT_EQ(a.size(), 1u);
+	EXPECT_EQ(a.front(), 4);
+	EXPECT_EQ(c.size(), 2u);
+	EXPECT_EQ(c.front(), 2);
+	EXPECT_EQ(a.get_allocator().resource(), &mr1);
+	EXPECT_EQ(c.get_allocator().resource(), &mr2);
+}
+
+// Тест: очереди можно хранить в std::vector
+TEST(QueueTest, StoredInVector)
+{
+	static_assert(std::is_nothrow_move_constructible_v<pmr_queue<int>>);
+
+	DynamicVectorMemoryResource mr;
+	std::vector<pmr_queue<int>> batches;
+	for (int i = 0; i < 10; ++i)
+	{
+		batches.emplace_back(&mr);
+		batches.back().push(i);
+	}
+	for (int i = 0; i < 10; ++i)
+	{
+		EXPECT_EQ(batches[i].front(), i);
+	}
+}
+
+// Тест: пакетная вставка и извлечение
+TEST(QueueTest, BatchOperations)
+{
+	DynamicVectorMemoryResource mr;
+	pmr_queue<int> q(&mr);
+	q.push(0);
+	q.push_range(std::vector<int>{1, 2, 3, 4, 5});
+	q.push_range(std::views::iota(6, 10));
+	EXPECT_EQ(q.size(), 10u);
+
+	EXPECT_EQ(q.pop_n(3), 3u);
+	EXPECT_EQ(q.front(), 3);
+	EXPECT_EQ(q.size(), 7u);
+
+	std::vector<int> drained;
+	q.drain_into(std::back_inserter(drained), 4);
+	EXPECT_EQ(drained, (std::vector<int>{3, 4, 5, 6}));
+	EXPECT_EQ(q.size(), 3u);
+
+	EXPECT_EQ(q.pop_n(100), 3u);
+	EXPECT_TRUE(q.empty());
+	EXPECT_EQ(q.begin(), q.end());
+	EXPECT_EQ(q.pop_n(1), 0u);
+
+	q.push_range(std::vector<int>{});
+	EXPECT_TRUE(q.empty());
+	q.push_range(std::vector<int>{11, 12});
+	q.drain_into(std::back_inserter(drained));
+	EXPECT_EQ(drained.back(), 12);
+	EXPECT_TRUE(q.empty());
+}
+
+struct ThrowOnCopy
+{
+	int value;
+	explicit ThrowOnCopy(int v) : value(v) {}
+	ThrowOnCopy(const ThrowOnCopy &other) : value(other.value)
+	{
+		if (value < 0)
+			throw std::runtime_error("copy");
+	}
+};
+
+// Тест: исключение внутри push_range не меняет очередь
+TEST(QueueTest, PushRangeIsAtomic)
+{
+	CountingResource upstream;
+	{
+		pmr_queue<ThrowOnCopy> q(&upstream);
+		q.emplace(1);
+		std::vector<ThrowOnCopy> batch;
+		batch.reserve(3);
+		batch.emplace_back(2);
+		batch.emplace_back(3);
+		batch.emplace_back(-1);
+		EXPECT_THROW(q.push_range(batch), std::runtime_error);
+		EXPECT_EQ(q.size(), 1u);
+		EXPECT_EQ(q.front().value, 1);
+		EXPECT_EQ(std::distance(q.begin(), q.end()), 1);
+	}
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+}
+
+// Тест: исключение при push в новый сегмент не оставляет пустой хвостовой сегмент
+TEST(SegmentedQueueTest, ThrowingPushLeavesQueueIntact)
+{
+	CountingResource upstream;
+	{
+		pmr_segmented_queue<ThrowOnCopy, 4> q(&upstream);
+		for (int i = 0; i < 4; ++i)
+		{
+			q.emplace(i);
+		}
+		EXPECT_THROW(q.push(ThrowOnCopy(-1)), std::runtime_error);
+		EXPECT_EQ(q.size(), 4u);
+		for (int i = 0; i < 4; ++i)
+		{
+			EXPECT_EQ(q.front().value, i);
+			q.pop();
+		}
+		q.emplace(42);
+		EXPECT_EQ(q.front().value, 42);
+		EXPECT_EQ(std::distance(q.begin(), q.end()), 1);
+	}
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+}
+
+// Тест: кэш узлов делает push/pop в установившемся режиме безаллокационными
+TEST(QueueTest, NodeCacheRecyclesNodes)
+{
+	CountingResource upstream;
+	{
+		pmr_queue<int> q(&upstream);
+		EXPECT_EQ(q.node_cache_limit(), 0u);
+
+		q.reserve(32);
+		EXPECT_EQ(q.capacity(), 32u);
+		EXPECT_EQ(q.node_cache_limit(), 32u);
+		const std::size_t allocations = upstream.allocations;
+
+		for (int i = 0; i < 10000; ++i)
+		{
+			q.push(i);
+			if (q.size() > 16)
+			{
+				q.pop();
+			}
+		}
+		q.pop_n(8);
+		q.push_range(std::vector<int>{1, 2, 3});
+		EXPECT_EQ(upstream.allocations, allocations);
+		EXPECT_EQ(q.capacity(), 32u);
+
+		q.shrink_to_fit();
+		EXPECT_EQ(q.capacity(), q.size());
+		EXPECT_EQ(upstream.outstanding_bytes, q.size() * sizeof(QueueNode<int>));
+
+		q.set_node_cache_limit(4);
+		q.clear();
+		EXPECT_EQ(q.capacity(), 4u);
+	}
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+}
+
+// Тест: splice_back и split_front перевешивают узлы без перевыделения
+TEST(QueueTest, SpliceAndSplit)
+{
+	DynamicVectorMemoryResource mr;
+	pmr_queue<int> a(&mr);
+	pmr_queue<int> b(&mr);
+	a.push_range(std::vector<int>{1, 2});
+	b.push_range(std::vector<int>{3, 4, 5});
+	const int *moved_node = &b.front();
+
+	a.splice_back(b);
+	EXPECT_TRUE(b.empty());
+	EXPECT_EQ(a.size(), 5u);
+	EXPECT_EQ(std::vector<int>(a.begin(), a.end()), (std::vector<int>{1, 2, 3, 4, 5}));
+	EXPECT_EQ(&*std::next(a.begin(), 2), moved_node);
+
+	b.splice_back(a);
+	EXPECT_EQ(b.size(), 5u);
+	b.push(6);
+	EXPECT_EQ(b.size(), 6u);
+
+	pmr_queue<int> head = b.split_front(2);
+	EXPECT_EQ(std::vector<int>(head.begin(), head.end()), (std::vector<int>{1, 2}));
+	EXPECT_EQ(std::vector<int>(b.begin(), b.end()), (std::vector<int>{3, 4, 5, 6}));
+	EXPECT_EQ(&b.front(), moved_node);
+
+	pmr_queue<int> rest = b.split_front(10);
+	EXPECT_TRUE(b.empty());
+	EXPECT_EQ(rest.size(), 4u);
+	b.push(7);
+	EXPECT_EQ(b.front(), 7);
+	EXPECT_TRUE(b.split_front(0).empty());
+
+	// На другом ресурсе элементы переносятся по одному
+	DynamicVectorMemoryResource other_mr;
+	pmr_queue<int> other(&other_mr);
+	other.push(8);
+	b.splice_back(other);
+	EXPECT_TRUE(other.empty());
+	EXPECT_EQ(std::vector<int>(b.begin(), b.end()), (std::vector<int>{7, 8}));
+}
+
+// Тест: извлечение без исключений
+TEST(QueueTest, TryPopAndTryFront)
+{
+	DynamicVectorMemoryResource mr;
+	pmr_queue<std::string> q(&mr);
+	static_assert(noexcept(q.try_pop(std::declval<std::string &>())));
+	static_assert(noexcept(q.try_front()));
+	static_assert(noexcept(q.pop_front_value()));
+
+	std::string out = "untouched";
+	EXPECT_FALSE(q.try_pop(out));
+	EXPECT_EQ(out, "untouched");
+	EXPECT_EQ(q.try_front(), nullptr);
+	EXPECT_FALSE(q.pop_front_value().has_value());
+
+	q.push("first");
+	q.push("second");
+	q.push("third");
+	ASSERT_NE(q.try_front(), nullptr);
+	EXPECT_EQ(*q.try_front(), "first");
+
+	EXPECT_TRUE(q.try_pop(out));
+	EXPECT_EQ(out, "first");
+	EXPECT_EQ(q.size(), 2u);
+
+	std::optional<std::string> value = q.pop_front_value();
+	ASSERT_TRUE(value.has_value());
+	EXPECT_EQ(*value, "second");
+
+	const pmr_queue<std::string> &cq = q;
+	ASSERT_NE(cq.try_front(), nullptr);
+	EXPECT_EQ(*cq.try_front(), "third");
+	EXPECT_TRUE(q.try_pop(out));
+	EXPECT_TRUE(q.empty());
+}
+
+// Тест: короткая очередь не обращается к ресурсу, длинная вытесняет хвост
+TEST(SmallQueueTest, KeepsFirstElementsInline)
+{
+	CountingResource upstream;
+	{
+		pmr_small_queue<std::string, 4> q(&upstream);
+		EXPECT_TRUE(q.empty());
+		EXPECT_EQ(q.begin(), q.end());
+		EXPECT_THROW(q.pop(), std::runtime_error);
+
+		for (int round = 0; round < 100; ++round)
+		{
+			q.push("a");
+			q.emplace(3, 'b');
+			q.pop();
+			q.pop();
+		}
+		EXPECT_EQ(upstream.allocations, 0u);
+
+		for (int i = 0; i < 10; ++i)
+		{
+			q.push(std::to_string(i));
+		}
+		EXPECT_EQ(q.size(), 10u);
+		EXPECT_EQ(q.inline_size(), 4u);
+		EXPECT_GT(upstream.allocations, 0u);
+
+		std::vector<std::string> expected;
+		for (int i = 0; i < 10; ++i)
+		{
+			expected.push_back(std::to_string(i));
+		}
+		EXPECT_EQ(std::vector<std::string>(q.begin(), q.end()), expected);
+
+		for (int i = 0; i < 10; ++i)
+		{
+			EXPECT_EQ(q.front(), std::to_string(i));
+			q.pop();
+			q.push(std::to_string(10 + i));
+		}
+		EXPECT_EQ(q.front(), "10");
+		EXPECT_EQ(q.size(), 10u);
+	}
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+}
+
+// Тест: SPSC-очередь в одном потоке
+TEST(SpscQueueTest, BoundedFifo)
+{
+	DynamicVectorMemoryResource mr;
+	pmr_spsc_queue<std::string> q(3, &mr);
+	EXPECT_EQ(q.capacity(), 4u);
+	EXPECT_THROW(pmr_spsc_queue<int>(0, &mr), std::invalid_argument);
+
+	std::string out;
+	EXPECT_FALSE(q.try_pop(out));
+	for (int i = 0; i < 4; ++i)
+	{
+		EXPECT_TRUE(q.try_push(std::to_string(i)));
+	}
+	EXPECT_FALSE(q.try_push("overflow"));
+	EXPECT_EQ(q.size(), 4u);
+
+	EXPECT_TRUE(q.try_pop(out));
+	EXPECT_EQ(out, "0");
+	EXPECT_TRUE(q.try_emplace(5, 'x'));
+	EXPECT_TRUE(q.try_pop(out));
+	EXPECT_EQ(out, "1");
+	// Оставшиеся элементы разрушает деструктор
+}
+
+// Тест: SPSC-очередь между двумя потоками сохраняет порядок
+TEST(SpscQueueTest, TwoThreadsKeepOrder)
+{
+	constexpr int count = 200000;
+	DynamicVectorMemoryResource mr;
+	pmr_spsc_queue<int> q(64, &mr);
+
+	std::thread producer([&q]
+						 {
+		for (int i = 0; i < count; ++i)
+		{
+			while (!q.try_push(i))
+			{
+				std::this_thread::yield();
+			}
+		} });
+
+	int expected = 0;
+	int value = 0;
+	while (expected < count)
+	{
+		if (q.try_pop(value))
+		{
+			ASSERT_EQ(value, expected);
+			++expected;
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	EXPECT_TRUE(q.empty());
+}
+
+
+// Тест: MPMC-очередь в одном потоке ведёт себя как FIFO и возвращает все узлы
+TEST(MpmcQueueTest, SingleThreadFifo)
+{
+	CountingResource counting;
+	{
+		// Пустая очередь не резервирует списки отложенных узлов заранее
+		pmr_mpmc_queue<int> empty(&counting);
+		EXPECT_LT(counting.outstanding_bytes, 16u * 1024);
+	}
+	{
+		pmr_mpmc_queue<std::pmr::string> q(&counting);
+		std::pmr::string out;
+		EXPECT_FALSE(q.try_pop(out));
+		for (int i = 0; i < 2000; ++i)
+		{
+			q.push(std::pmr::string("value_" + std::to_string(i) + "_long_enough_to_allocate"));
+		}
+		EXPECT_EQ(q.size(), 2000u);
+		for (int i = 0; i < 1500; ++i)
+		{
+			ASSERT_TRUE(q.try_pop(out));
+			EXPECT_EQ(std::string(out), "value_" + std::to_string(i) + "_long_enough_to_allocate");
+		}
+		EXPECT_EQ(q.size(), 500u);
+		// Часть узлов уже освобождена через hazard pointers, не дожидаясь деструктора
+		EXPECT_GT(counting.deallocations, 0u);
+	}
+	EXPECT_EQ(counting.allocations, counting.deallocations);
+	EXPECT_EQ(counting.outstanding_bytes, 0u);
+}
+
+// Тест: несколько производителей и потребителей не теряют и не дублируют элементы
+TEST(MpmcQueueTest, ConcurrentProducersAndConsumers)
+{
+	constexpr int threads = 4;
+	constexpr int per_thread = 20000;
+	std::pmr::synchronized_pool_resource mr;
+	pmr_mpmc_queue<int> q(&mr);
+
+	std::vector<std::thread> workers;
+	std::vector<std::vector<int>> received(threads);
+	for (int t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&q, t]
+							 {
+			for (int i = 0; i < per_thread; ++i)
+			{
+				q.push(t * per_thread + i);
+			} });
+		workers.emplace_back([&q, &received, t]
+							 {
+			int value = 0;
+			while (static_cast<int>(received[t].size()) < per_thread)
+			{
+				if (q.try_pop(value))
+				{
+					received[t].push_back(value);
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			} });
+	}
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+	EXPECT_TRUE(q.empty());
+
+	std::vector<int> all;
+	for (const auto &part : received)
+	{
+		// Значения одного производителя приходят к потребителю по возрастанию
+		std::vector<int> last(threads, -1);
+		for (int v : part)
+		{
+			EXPECT_GT(v, last[v / per_thread]);
+			last[v / per_thread] = v;
+		}
+		all.insert(all.end(), part.begin(), part.end());
+	}
+	std::sort(all.begin(), all.end());
+	ASSERT_EQ(all.size(), static_cast<std::size_t>(threads * per_thread));
+	for (int i = 0; i < threads * per_thread; ++i)
+	{
+		ASSERT_EQ(all[i], i);
+	}
+}
+
+// Тест: ограниченная MPMC-очередь сообщает о заполнении и пустоте, не выделяя память на элемент
+TEST(BoundedMpmcQueueTest, FullEmptyAndWrapAround)
+{
+	CountingResource counting;
+	{
+		pmr_bounded_mpmc_queue<std::pmr::string> q(5, &counting);
+		EXPECT_EQ(q.capacity(), 8u);
+		EXPECT_THROW(pmr_bounded_mpmc_queue<int>(0, &counting), std::invalid_argument);
+		const std::size_t slot_allocations = counting.allocations;
+
+		std::pmr::string out;
+		EXPECT_FALSE(q.try_pop(out));
+		for (int round = 0; round < 3; ++round)
+		{
+			for (int i = 0; i < 8; ++i)
+			{
+				EXPECT_TRUE(q.try_push(std::pmr::string(std::to_string(round * 8 + i))));
+			}
+			EXPECT_FALSE(q.try_emplace("overflow"));
+			EXPECT_EQ(q.size(), 8u);
+			for (int i = 0; i < 6; ++i)
+			{
+				ASSERT_TRUE(q.try_pop(out));
+				EXPECT_EQ(std::string(out), std::to_string(round * 8 + i));
+			}
+			ASSERT_TRUE(q.try_pop(out));
+			ASSERT_TRUE(q.try_pop(out));
+			EXPECT_TRUE(q.empty());
+		}
+		// Короткие строки не выделяют память, значит сама очередь после конструктора не выделяла
+		EXPECT_EQ(counting.allocations, slot_allocations);
+		EXPECT_TRUE(q.try_push(std::pmr::string("left for destructor")));
+	}
+	EXPECT_EQ(counting.outstanding_bytes, 0u);
+
+	// Перемещение строки из другого ресурса выделяет память; исключение не занимает ячейку
+	std::array<std::byte, 512> buffer;
+	std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+	pmr_bounded_mpmc_queue<std::pmr::string> q(4, &arena);
+	std::pmr::string big(1000, 'x');
+	EXPECT_THROW(q.try_push(std::move(big)), std::bad_alloc);
+	EXPECT_TRUE(q.try_push(std::pmr::string("ok")));
+	std::pmr::string out;
+	ASSERT_TRUE(q.try_pop(out));
+	EXPECT_EQ(std::string(out), "ok");
+}
+
+// Тест: ограниченная MPMC-очередь под нагрузкой нескольких производителей и потребителей
+TEST(BoundedMpmcQueueTest, ConcurrentProducersAndConsumers)
+{
+	constexpr int threads = 4;
+	constexpr int per_thread = 20000;
+	DynamicVectorMemoryResource mr;
+	pmr_bounded_mpmc_queue<int> q(64, &mr);
+
+	std::vector<std::thread> workers;
+	std::vector<long long> sums(threads, 0);
+	for (int t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&q, t]
+							 {
+			for (int i = 0; i < per_thread; ++i)
+			{
+				while (!q.try_push(t * per_thread + i))
+				{
+					std::this_thread::yield();
+				}
+			} });
+		workers.emplace_back([&q, &sums, t]
+							 {
+			int value = 0;
+			for (int received = 0; received < per_thread;)
+			{
+				if (q.try_pop(value))
+				{
+					sums[t] += value;
+					++received;
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			} });
+	}
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+
+	const long long total = static_cast<long long>(threads) * per_thread;
+	long long sum = 0;
+	for (long long part : sums)
+	{
+		sum += part;
+	}
+	EXPECT_EQ(sum, total * (total - 1) / 2);
+	EXPECT_TRUE(q.empty());
+}
+
+
+// Тест: блокирующая очередь передаёт элементы между потоками и отдаёт nullopt по таймауту
+TEST(BlockingQueueTest, PopWaitAndTimeout)
+{
+	DynamicVectorMemoryResource mr;
+	pmr_blocking_queue<std::pmr::string> q(&mr);
+
+	EXPECT_EQ(q.pop_wait_for(std::chrono::milliseconds(5)), std::nullopt);
+
+	std::thread producer([&q]
+						 {
+		for (int i = 0; i < 1000; ++i)
+		{
+			q.push(std::pmr::string("item " + std::to_string(i)));
+		} });
+	for (int i = 0; i < 1000; ++i)
+	{
+		std::optional<std::pmr::string> value = q.pop_wait();
+		ASSERT_TRUE(value.has_value());
+		EXPECT_EQ(std::string(*value), "item " + std::to_string(i));
+	}
+	producer.join();
+	EXPECT_TRUE(q.empty());
+}
+
+// Тест: stop_token прерывает ожидание пустой очереди
+TEST(BlockingQueueTest, StopTokenEndsWait)
+{
+	pmr_blocking_queue<int> q;
+	std::optional<int> result = 0;
+	std::jthread consumer([&q, &result](std::stop_token stop)
+						  { result = q.pop_wait(stop); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	consumer.request_stop();
+	consumer.join();
+	EXPECT_EQ(result, std::nullopt);
+
+	std::stop_source stopped;
+	stopped.request_stop();
+	q.push(7);
+	// Уже накопленные элементы отдаются и после запроса остановки
+	EXPECT_EQ(q.pop_wait(stopped.get_token()), 7);
+}
+
+// Тест: пакетное ожидание будится по порогу, по max_latency и по flush()
+TEST(BlockingQueueTest, BatchThresholdLatencyAndFlush)
+{
+	{
+		pmr_blocking_queue<int> q(8, std::chrono::seconds(30));
+		std::vector<int> batch;
+		std::thread consumer([&q, &batch]
+							 { q.pop_batch_wait(std::back_inserter(batch), 100); });
+		for (int i = 0; i < 8; ++i)
+		{
+			q.push(i);
+		}
+		consumer.join();
+		// Порог достигнут: потребитель забирает все элементы, пришедшие к моменту пробуждения
+		ASSERT_FALSE(batch.empty());
+		for (std::size_t i = 0; i < batch.size(); ++i)
+		{
+			EXPECT_EQ(batch[i], static_cast<int>(i));
+		}
+	}
+	{
+		pmr_blocking_queue<int> q(100, std::chrono::milliseconds(10));
+		q.push(1);
+		q.push(2);
+		std::vector<int> batch;
+		q.pop_batch_wait(std::back_inserter(batch), 100);
+		EXPECT_EQ(batch, (std::vector<int>{1, 2}));
+	}
+	{
+		pmr_blocking_queue<int> q(100, std::chrono::seconds(30));
+		q.push(3);
+		std::vector<int> batch;
+		std::atomic<bool> done = false;
+		std::thread consumer([&]
+							 {
+			q.pop_batch_wait(std::back_inserter(batch), 1);
+			done = true; });
+		while (!done)
+		{
+			q.flush();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		consumer.join();
+		EXPECT_EQ(batch, std::vector<int>{3});
+	}
+}
+
+// Тест: max_latency отсчитывается от появления элемента, а не от вызова pop_wait()
+TEST(BlockingQueueTest, LatencyCountsFromFirstPendingElement)
+{
+	pmr_blocking_queue<int> q(64, std::chrono::milliseconds(100));
+	for (int i = 0; i < 10; ++i)
+	{
+		q.push(i);
+	}
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < 10; ++i)
+	{
+		EXPECT_EQ(q.pop_wait(), i);
+	}
+	// Ждать max_latency на каждый элемент — это около секунды
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(400));
+}
+
+// Тест: если элемент забрал другой потребитель, pop_wait() продолжает ждать
+TEST(BlockingQueueTest, WaitResumesWhenAnotherConsumerTakesItems)
+{
+	pmr_blocking_queue<int> q(4, std::chrono::milliseconds(200));
+	std::optional<int> result;
+	std::atomic<bool> done = false;
+	std::thread consumer([&]
+						 {
+		result = q.pop_wait();
+		done = true; });
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	q.push(1);
+	// Потребитель проснулся и ждёт порога; элемент уводит второй потребитель
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	int taken = 0;
+	ASSERT_TRUE(q.try_pop(taken));
+	EXPECT_EQ(taken, 1);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(300));
+	EXPECT_FALSE(done);
+	q.push(2);
+	q.flush();
+	consumer.join();
+	EXPECT_EQ(result, 2);
+
+	// pop_wait_for() тоже не сдаётся раньше срока
+	std::thread producer([&q]
+						 {
+		q.push(3);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		int stolen = 0;
+		q.try_pop(stolen);
+		std::this_thread::sleep_for(std::chrono::milliseconds(300));
+		q.push(4);
+		q.flush(); });
+	std::optional<int> later = q.pop_wait_for(std::chrono::seconds(30));
+	producer.join();
+	ASSERT_TRUE(later.has_value());
+	EXPECT_TRUE(*later == 3 || *later == 4);
+}
+
+
+// Тест: блок, освобождённый другим потоком, возвращается в шард потока-владельца
+TEST(ShardedResourceTest, CrossThreadFreeReturnsToOwnerShard)
+{
+	ShardedDynamicVectorMemoryResource mr(4);
+	EXPECT_EQ(mr.shard_count(), 4u);
+
+	std::promise<void *> allocated;
+	std::promise<void> freed;
+	void *reused = nullptr;
+	std::thread worker([&]
+					   {
+		allocated.set_value(mr.allocate(48, 8));
+		freed.get_future().wait();
+		reused = mr.allocate(48, 8);
+		mr.deallocate(reused, 48, 8); });
+
+	void *p = allocated.get_future().get();
+	mr.deallocate(p, 48, 8);
+	freed.set_value();
+	worker.join();
+	EXPECT_EQ(reused, p);
+}
+
+// Тест: общий шардированный ресурс под очередями нескольких потоков
+TEST(ShardedResourceTest, SharedByConcurrentQueue)
+{
+	constexpr int threads = 4;
+	constexpr int per_thread = 5000;
+	ShardedDynamicVectorMemoryResource mr(0, DynamicVectorResourceOptions{64 * 1024});
+	EXPECT_GE(mr.shard_count(), 1u);
+	{
+		pmr_mpmc_queue<std::pmr::string> q(&mr);
+		std::vector<std::thread> workers;
+		std::atomic<int> received = 0;
+		for (int t = 0; t < threads; ++t)
+		{
+			workers.emplace_back([&q]
+								 {
+				for (int i = 0; i < per_thread; ++i)
+				{
+					q.push(std::pmr::string("a string long enough to need its own block " + std::to_string(i)));
+				} });
+			workers.emplace_back([&q, &received]
+								 {
+				std::pmr::string value;
+				for (int got = 0; got < per_thread;)
+				{
+					if (q.try_pop(value))
+					{
+						EXPECT_EQ(value.rfind("a string", 0), 0u);
+						++got;
+					}
+					else
+					{
+						std::this_thread::yield();
+					}
+				}
+				received += per_thread; });
+		}
+		for (auto &worker : workers)
+		{
+			worker.join();
+		}
+		EXPECT_EQ(received, threads * per_thread);
+	}
+	EXPECT_GT(mr.metadata_bytes(), 0u);
+	mr.release();
+}
+
+
+// Тест: кэширующий ресурс обращается к upstream пачками блоков округлённого размера
+TEST(ThreadCachingResourceTest, BatchesUpstreamCalls)
+{
+	CountingResource upstream;
+	{
+		ThreadCachingMemoryResource mr(&upstream);
+		std::vector<void *> blocks;
+		for (int i = 0; i < 10; ++i)
+		{
+			blocks.push_back(mr.allocate(40));
+		}
+		// Все десять блоков взяты из одного пакета в magazine_capacity / 2 блоков
+		const std::size_t batch = ThreadCachingMemoryResource::magazine_capacity / 2;
+		EXPECT_EQ(mr.upstream_lock_count(), 1u);
+		const std::size_t upstream_allocations = upstream.allocations;
+		for (int round = 0; round < 100; ++round)
+		{
+			for (void *p : blocks)
+			{
+				mr.deallocate(p, 40);
+			}
+			for (void *&p : blocks)
+			{
+				p = mr.allocate(40);
+			}
+		}
+		EXPECT_EQ(upstream.allocations, upstream_allocations);
+		EXPECT_EQ(mr.upstream_lock_count(), 1u);
+
+		// Крупные блоки идут напрямую в upstream
+		void *large = mr.allocate(4096);
+		mr.deallocate(large, 4096);
+		EXPECT_EQ(mr.upstream_lock_count(), 3u);
+
+		for (void *p : blocks)
+		{
+			mr.deallocate(p, 40);
+		}
+		mr.flush_thread_cache();
+		EXPECT_GE(upstream.deallocations, batch);
+	}
+	EXPECT_EQ(upstream.allocations, upstream.deallocations);
+	EXPECT_EQ(upstream.outstanding_bytes, 0u);
+}
+
+// Тест: очереди рабочих потоков поверх общего непотокобезопасного ресурса
+TEST(ThreadCachingResourceTest, WorkerQueuesAvoidSharedLock)
+{
+	constexpr int threads = 4;
+	DynamicVectorMemoryResource backend;
+	ThreadCachingMemoryResource mr(&backend);
+
+	std::vector<std::thread> workers;
+	std::vector<std::size_t> steady_locks(threads, 0);
+	for (int t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&mr, &steady_locks, t]
+							 {
+			pmr_queue<int> q(&mr);
+			q.set_node_cache_limit(0);
+			for (int i = 0; i < 64; ++i)
+			{
+				q.push(i);
+			}
+			const std::size_t before = mr.upstream_lock_count();
+			long long sum = 0;
+			for (int i = 0; i < 20000; ++i)
+			{
+				sum += q.front();
+				q.pop();
+				q.push(i);
+			}
+			const std::size_t after = mr.upstream_lock_count();
+			// Блоки этого потока оборачиваются через его магазин; чужие потоки могли добавить свои захваты
+			steady_locks[t] = after - before;
+			EXPECT_GT(sum, 0); });
+	}
+	for (auto &worker : workers)
+	{
+		worker.join();
+	}
+	for (std::size_t locks : steady_locks)
+	{
+		EXPECT_LT(locks, 100u);
+	}
+}